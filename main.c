@@ -1,9 +1,36 @@
+#define _GNU_SOURCE // pipe2, accept4 and the e mode of fopen, which open descriptors close-on-exec atomically
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
+
+// Number of bytes decoded per pass over a stream; instructions split across the end of a chunk are carried into the next one
+#define CHUNK_SIZE 65536
+// Default limit in megabytes on the images held by the server before least recently used ones are evicted
+#define CACHE_LIMIT 256
+// Number of stack entries followed by constant propagation; anything deeper is treated as unknown
+#define STACK_DEPTH 4
+// Most entries read from a single jump table
+#define TABLE_LIMIT 128
+// Bytes of input between the checkpoints of an instruction index
+#define CHECKPOINT_INTERVAL 4096
+
+#define BIT_SET(set, n) ((set)[(n) / 8] |= 1 << ((n) % 8))
+#define BIT_CLEAR(set, n) ((set)[(n) / 8] &= ~(1 << ((n) % 8)))
+#define BIT_TEST(set, n) ((set)[(n) / 8] & 1 << ((n) % 8))
+#define INSIDE(flow, address) ((address) >= (flow)->start && (address) < (flow)->end)
 
 /*
 Instructions in 8080 assembly use seven types of parameters:
@@ -25,19 +52,425 @@ typedef enum {
     S_16BIT
 } InstParam;
 
+// Bank is a range of the file mapped into the CPU address space at address, listed into text by a worker thread
+typedef struct {
+    int id;
+    uint64_t offset;
+    int length;
+    uint16_t address;
+    char *text;
+    size_t textSize;
+    int error;
+} Bank;
+
+// Trampoline is a routine that switches to bank before passing control into it
+typedef struct {
+    uint16_t address;
+    int bank;
+} Trampoline;
+
+/*
+BankMap describes a bank-switched image, read from a file with one entry per line and numbers in hexadecimal:
+bank id offset length address    (length bytes from offset in the file appear at CPU address when bank id is selected)
+trampoline address id            (calls and jumps to address continue in bank id)
+Anything after a '#' is a comment
+*/
+typedef struct {
+    Bank *banks;
+    int bankCount;
+    Trampoline *trampolines;
+    int trampolineCount;
+    int input; // Read by every worker with pread, so it is never seeked
+    int nextBank;
+    pthread_mutex_t lock; // Guards nextBank
+} BankMap;
+
+// Stats holds the instruction counts gathered by one worker thread over the files it took from a corpus
+typedef struct {
+    char **paths; // The corpus, shared by every worker
+    int pathCount;
+    int *nextPath; // Guarded by lock
+    pthread_mutex_t *lock;
+    uint64_t files;
+    uint64_t failed;
+    uint64_t bytes;
+    uint64_t lengths[4];
+    uint64_t opcodes[256];
+    uint64_t pairs[65536]; // Indexed by first opcode << 8 | second opcode
+    uint32_t *triples; // Indexed by first opcode << 16 | second opcode << 8 | third opcode, only touched pages are resident
+    uint64_t *tripleTotals; // Shared by every worker, guarded by lock, receiving 2^32 each time a count in triples wraps
+} Stats;
+
+// Checkpoint is the first instruction boundary at or after a multiple of CHECKPOINT_INTERVAL, and its line in the listing counting from 0
+typedef struct {
+    uint64_t offset;
+    uint64_t line;
+} Checkpoint;
+
+// IndexHeader starts an index file, followed by count checkpoints, and identifies the input it was built from
+typedef struct {
+    char magic[4];
+    uint32_t interval;
+    uint64_t size;
+    int64_t modified;
+    uint64_t count;
+} IndexHeader;
+
+// AccessMap counts the memory addresses and ports named by the operands of the instructions listed
+// LDA and LHLD read and STA and SHLD write each byte they cover, and IN and OUT use their port
+typedef struct {
+    uint8_t read[8192]; // Bitmaps by CPU address
+    uint8_t written[8192];
+    uint32_t reads[65536]; // Reference counts by CPU address
+    uint32_t writes[65536];
+    uint8_t input[32]; // Bitmaps by port
+    uint8_t output[32];
+    uint32_t ins[256]; // Reference counts by port
+    uint32_t outs[256];
+} AccessMap;
+
+// Listing is where a disassembly is printed and origin the CPU address at which file location 0 is loaded
+// CPU addresses wrap at 64 KB, so origin may also place a later part of the file, such as a bank, at its CPU address
+// Calls and jumps to the trampolines of map, if not NULL, are annotated with the bank they enter
+// The memory and port references of each instruction printed are added to access if it is not NULL
+typedef struct {
+    FILE *out;
+    uint16_t origin;
+    BankMap *map;
+    AccessMap *access;
+} Listing;
+
+// XRef records an instruction at from whose 16-bit operand is the address to
+typedef struct {
+    int to;
+    int from;
+} XRef;
+
+/*
+Image is a file loaded and decoded by the server, shared read-only between every client using it
+The bytes, instruction boundaries and cross references are never modified once built, so clients read them without locking
+Only users, lastUse, stale and next are guarded by cacheLock
+*/
+typedef struct Image {
+    char *path;
+    dev_t device;
+    ino_t inode;
+    time_t modified;
+    uint8_t *bytes; // Contents of the file followed by two zero bytes
+    int size;
+    uint8_t *starts; // Bitmap of the locations at which the linear sweep starts an instruction
+    XRef *xrefs; // Sorted by target address
+    int xrefCount;
+    size_t footprint;
+    int users;
+    unsigned long lastUse;
+    int stale;
+    struct Image *next;
+} Image;
+
+/*
+Constant propagation tracks every 8-bit register as one of these abstract values:
+V_UNKNOWN (contents not known)
+V_CONST (contents are value)
+V_INDEX (HL is value plus an unknown index, H holds the table address and L the known part of the offset)
+V_TABLE_LO (low byte of a word read from the jump table at value)
+V_TABLE_HI (high byte of a word read from the jump table at value)
+V_RETURN (half of a return address pushed by a call, only found on the stack)
+*/
+typedef enum {
+    V_UNKNOWN,
+    V_CONST,
+    V_INDEX,
+    V_TABLE_LO,
+    V_TABLE_HI,
+    V_RETURN
+} ValueKind;
+
+typedef struct {
+    uint8_t kind;
+    uint16_t value;
+} Value;
+
+// RegState is the abstract state of the processor on entry to an instruction
+typedef struct {
+    Value reg[8]; // Registers in the order opcodes encode them: B, C, D, E, H, L, M (unused), A
+    Value stack[STACK_DEPTH][2]; // Top of stack first, each entry high byte then low byte
+    int depth; // Number of stack entries known
+} RegState;
+
+// Flow is the control flow recovered from the entry points of an image loaded into the 64 KB address space
+typedef struct {
+    uint8_t memory[65536 + 2]; // The image at its CPU address, with room for the operands of an instruction at ffff
+    int start; // CPU addresses from start up to end hold the image
+    int end;
+    uint8_t code[8192]; // Bitmap of the addresses reached as the start of an instruction
+    uint8_t pending[8192]; // Bitmap of the addresses whose entry state changed since they were last visited
+    RegState state[65536];
+} Flow;
+
+// Flags of a routine whose stack use could not be fully bounded
+#define STACK_RECURSIVE 1 // Calls itself, directly or through other routines
+#define STACK_UNKNOWN 2 // Loads SP from HL, or jumps to an unresolved address or calls outside the image
+#define STACK_UNBALANCED 4 // Reaches an instruction or a return with different amounts on the stack
+
+#define STACK_UNREACHED INT16_MIN // In the depth of an address not yet reached by the routine being walked
+
+// CallSite is a call from a routine, depth bytes below the routine's entry stack pointer, into the routine at callee
+// A jump to another routine is a call whose return address is not pushed, and is recorded with tail set
+typedef struct {
+    uint16_t callee;
+    int depth;
+    int tail;
+} CallSite;
+
+// Routine is the stack use of the code reached from a routine's entry without entering the routines it calls
+typedef struct {
+    uint16_t address;
+    int local; // Most bytes pushed by the routine itself
+    int worst; // Most bytes pushed by the routine and the routines it calls, -1 until computed
+    int firstCall; // Calls made by the routine, in the call pool of its StackReport
+    int callCount;
+    int flags;
+    int shared; // Set for code reached from several routines, made a routine of its own so it is only walked once
+    int visiting; // Set while the call graph search is below this routine, to find recursion
+} Routine;
+
+// StackReport is the call graph of a Flow, with routines in address order and the calls of each routine together in calls
+typedef struct {
+    Routine *routines;
+    int routineCount;
+    CallSite *calls;
+    int callCount;
+    int callCapacity;
+    int routineOf[65536]; // Index in routines of the routine starting at each address, or -1
+} StackReport;
+
 // void fillBuffer(FILE *input, int8_t buffer, int size);
-uint8_t *fillBuffer(FILE *input, int size);
-int findSize(FILE *input);
-int printInstruction(uint8_t *buffer, int location, int instSize, char *instName, char *reg1, char *reg2, InstParam parameter);
-void readBuffer(uint8_t *buffer, int size);
+uint8_t *fillBuffer(FILE *input, int *size);
+FILE *openInput(char *path, pid_t *decompressor);
+int closeInput(FILE *input, pid_t decompressor);
+void decodeStream(Listing *list, FILE *input, uint8_t *image, int *imageSize);
+int instLength(uint8_t opcode);
+uint64_t printInstruction(Listing *list, uint8_t *buffer, uint64_t location, int instSize, char *instName, char *reg1, char *reg2, InstParam parameter);
+int readBuffer(Listing *list, uint8_t *window, uint64_t location, int size, int final);
+void noteAccess(AccessMap *access, uint8_t *inst);
+void printAccess(FILE *out, AccessMap *access);
+void serve(char *socketPath, size_t limit);
+void *serveClient(void *arg);
+Image *loadImage(char *path, struct stat *info);
+void freeImage(Image *image);
+Image *acquireImage(char *path);
+void releaseImage(Image *image);
+void evictImages(void);
+int instructionAt(Image *image, int location);
+int compareXRef(const void *a, const void *b);
+BankMap *readBankMap(char *path);
+void decodeBanks(BankMap *map, char *path);
+void *decodeBank(void *arg);
+void countCorpus(char **paths, int pathCount, int json);
+void *countFiles(void *arg);
+int countStream(Stats *stats, FILE *input);
+Checkpoint *buildIndex(FILE *input, uint64_t *count);
+Checkpoint *readIndex(char *path, struct stat *source, uint64_t *count);
+void writeIndex(char *path, struct stat *source, Checkpoint *index, uint64_t count);
+int printAt(Listing *list, FILE *input, Checkpoint *index, uint64_t count, int byLine, uint64_t target, uint64_t lines);
+Flow *analyseFlow(uint8_t *image, int size, uint16_t origin);
+void visit(Flow *flow, int location);
+void propagate(Flow *flow, int location, RegState *state);
+void transfer(Flow *flow, RegState *state, uint8_t *inst);
+int jumpTargets(Flow *flow, int location, RegState *state, uint16_t *targets, int *table);
+void printJumps(FILE *out, Flow *flow);
+int flowSuccessors(Flow *flow, int location, uint16_t *targets, int *callee);
+StackReport *analyseStack(Flow *flow);
+void shareRoutines(Flow *flow, StackReport *report);
+int *growEdges(int *edges, int *capacity, int needed);
+void walkRoutine(Flow *flow, StackReport *report, int routine, int16_t *depthAt, uint16_t *work);
+int worstStack(StackReport *report, int routine);
+void printStack(FILE *out, Flow *flow, StackReport *report);
+void translate(FILE *out, Flow *flow, StackReport *report);
+void translateRoutine(FILE *out, Flow *flow, StackReport *report, int routine, uint8_t *member, uint8_t *leader, uint16_t *work);
+void translateInstruction(FILE *out, Flow *flow, StackReport *report, int location, uint8_t *member, uint8_t *leader, int next);
+void translateJump(FILE *out, uint8_t *member, int target);
+void translateTable(FILE *out, Flow *flow, int location, uint8_t *member, char *value);
+void translateCall(FILE *out, StackReport *report, int target, int ret);
+int compareAddress(const void *a, const void *b);
+
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+static Image *cache = NULL; // Most recently loaded first
+static size_t cacheUsed = 0;
+static size_t cacheLimit = (size_t)CACHE_LIMIT << 20;
+static unsigned long cacheClock = 0;
 
 int main(int argc, char *argv[])
 {
     FILE *source;
-    int fileSize;
-    if(argv[1])
+    pid_t decompressor;
+    char *socketPath = NULL;
+    long limit = CACHE_LIMIT;
+    int jumps = 0;
+    int stack = 0;
+    int translation = 0;
+    int accesses = 0;
+    AccessMap *access = NULL;
+    StackReport *report;
+    int option;
+    long origin = 0;
+    char *mapPath = NULL;
+    char *statsFormat = NULL;
+    char *indexPath = NULL;
+    int byLine = -1;
+    uint64_t target = 0;
+    uint64_t lines = 1;
+    struct stat info;
+    Checkpoint *index = NULL;
+    uint64_t checkpoints;
+    Listing list = {stdout, 0, NULL, NULL};
+    uint8_t *image = NULL;
+    int size = 0;
+    Flow *flow;
+
+    while((option = getopt(argc, argv, "S:m:jkcro:b:t:x:a:l:n:")) != -1)
+    {
+        switch(option)
+        {
+        case 'x': // Instruction index file, used if it is up to date and written otherwise
+            indexPath = optarg;
+            break;
+        case 'a': // List from the instruction containing this file location, in hexadecimal
+            byLine = 0;
+            target = strtoull(optarg, NULL, 16);
+            break;
+        case 'l': // List from this line of the listing, counting from 0
+            byLine = 1;
+            target = strtoull(optarg, NULL, 10);
+            break;
+        case 'n': // Number of lines to list with -a or -l
+            lines = strtoull(optarg, NULL, 10);
+            break;
+        case 't': // Count opcodes and instruction sequences over every file given, printed as csv or json, instead of listing them
+            statsFormat = optarg;
+            if(strcmp(statsFormat,"csv") != 0 && strcmp(statsFormat,"json") != 0)
+            {
+                fprintf(stderr,"%s\n",strerror(22));
+                exit(22);
+            }
+            break;
+        case 'b': // Disassemble the banks described by a bank map
+            mapPath = optarg;
+            break;
+        case 'o': // CPU address at which the file is loaded, in hexadecimal
+            origin = strtol(optarg, NULL, 16);
+            if(origin < 0 || origin > 0xffff)
+            {
+                fprintf(stderr,"%s\n",strerror(22));
+                exit(22);
+            }
+            list.origin = origin;
+            break;
+        case 'j': // Report the targets of indirect jumps after the listing
+            jumps = 1;
+            break;
+        case 'k': // Report the call graph and worst case stack depth of each routine after the listing
+            stack = 1;
+            break;
+        case 'c': // Translate the image to C instead of listing it
+            translation = 1;
+            break;
+        case 'r': // Report the memory addresses and ports used by the listing after it
+            accesses = 1;
+            break;
+        case 'S': // Serve requests on a Unix domain socket instead of disassembling a file
+            socketPath = optarg;
+            break;
+        case 'm': // Server image cache limit in megabytes
+            limit = strtol(optarg, NULL, 0);
+            if(limit <= 0)
+            {
+                fprintf(stderr,"%s\n",strerror(22));
+                exit(22);
+            }
+            break;
+        default:
+            // invalid argument
+            fprintf(stderr,"%s\n",strerror(22));
+            exit(22);
+        }
+    }
+    if(socketPath != NULL)
+    {
+        serve(socketPath, (size_t)limit << 20);
+        return(0);
+    }
+
+    if(statsFormat != NULL && optind < argc)
+    {
+        countCorpus(argv + optind, argc - optind, strcmp(statsFormat,"json") == 0);
+        return(0);
+    }
+
+    if((indexPath != NULL || byLine >= 0) && optind < argc)
+    {
+        if(stat(argv[optind], &info) != 0)
+        {
+            fprintf(stderr,"%s\n",strerror(2));
+            exit(2);
+        }
+        if(indexPath != NULL)
+        {
+            index = readIndex(indexPath, &info, &checkpoints);
+        }
+        if(index == NULL)
+        {
+            source = openInput(argv[optind], &decompressor);
+            if(source == NULL)
+            {
+                fprintf(stderr,"%s\n",strerror(2));
+                exit(2);
+            }
+            index = buildIndex(source, &checkpoints);
+            if(closeInput(source, decompressor) != 0)
+            {
+                fprintf(stderr,"%s\n",strerror(5));
+                exit(5);
+            }
+            if(indexPath != NULL)
+            {
+                writeIndex(indexPath, &info, index, checkpoints);
+            }
+        }
+        if(byLine >= 0)
+        {
+            source = openInput(argv[optind], &decompressor);
+            if(source == NULL)
+            {
+                fprintf(stderr,"%s\n",strerror(2));
+                exit(2);
+            }
+            if(printAt(&list, source, index, checkpoints, byLine, target, lines) != 0)
+            {
+                // numerical result out of range
+                fprintf(stderr,"%s\n",strerror(34));
+                exit(34);
+            }
+            if(closeInput(source, decompressor) != 0)
+            {
+                fprintf(stderr,"%s\n",strerror(5));
+                exit(5);
+            }
+        }
+        free(index);
+        return(0);
+    }
+
+    if(mapPath != NULL && optind < argc)
+    {
+        decodeBanks(readBankMap(mapPath), argv[optind]);
+        return(0);
+    }
+
+    if(optind < argc)
     {
-        source = fopen(argv[1],"r");
+        source = openInput(argv[optind], &decompressor);
         if(source == NULL)
         {
             // no such file or directory
@@ -52,843 +485,3690 @@ int main(int argc, char *argv[])
         exit(22);
     }
 
-    fileSize = findSize(source);
-    uint8_t *fileBuffer = fillBuffer(source, fileSize);
-    readBuffer(fileBuffer, fileSize);
+    if(jumps || stack || translation)
+    {
+        // Analysis needs the part of the file that fits in the address space, which the listing keeps as it passes
+        image = (uint8_t *)malloc(65536 - list.origin);
+        if(image == NULL)
+        {
+            fprintf(stderr,"Out of memory!\n");
+            exit(99);
+        }
+    }
+    if(translation)
+    {
+        // The translation takes the place of the listing, so only that part is read
+        size = fread(image,sizeof(uint8_t),65536 - list.origin,source);
+    }
+    else
+    {
+        if(accesses)
+        {
+            access = (AccessMap *)calloc(1, sizeof(AccessMap));
+            if(access == NULL)
+            {
+                fprintf(stderr,"Out of memory!\n");
+                exit(99);
+            }
+        }
+        list.access = access;
+        decodeStream(&list, source, image, &size);
+        if(access != NULL)
+        {
+            printAccess(stdout, access);
+            free(access);
+        }
+    }
+    if(jumps || stack || translation)
+    {
+        flow = analyseFlow(image, size, list.origin);
+        if(jumps && !translation)
+        {
+            printJumps(stdout, flow);
+        }
+        if(stack || translation)
+        {
+            report = analyseStack(flow);
+            if(translation)
+            {
+                translate(stdout, flow, report);
+            }
+            else
+            {
+                printStack(stdout, flow, report);
+            }
+            free(report->routines);
+            free(report->calls);
+            free(report);
+        }
+        free(flow);
+        free(image);
+    }
 
-    fclose(source);
+    if(closeInput(source, decompressor) != 0)
+    {
+        // input/output error
+        fprintf(stderr,"%s\n",strerror(5));
+        exit(5);
+    }
     return(0);
 }
 
-uint8_t *fillBuffer(FILE *input, int size)
+// fillBuffer reads the whole of input, which may be a pipe of unknown length, into a buffer followed by two zero bytes
+// fillBuffer returns the buffer and sets size to the number of bytes read, or returns NULL with errno set if input could not be read, is 2 GB or more or does not fit in memory
+uint8_t *fillBuffer(FILE *input, int *size)
+{
+    uint8_t *buffer = NULL;
+    uint8_t *grown;
+    int capacity = 0;
+
+    *size = 0;
+    do
+    {
+        if(*size == capacity)
+        {
+            if(capacity > INT_MAX - CHUNK_SIZE - 2) // Images are addressed with int
+            {
+                free(buffer);
+                errno = EFBIG;
+                return(NULL);
+            }
+            capacity += CHUNK_SIZE;
+            grown = (uint8_t *)realloc(buffer, capacity + 2);
+            if(grown == NULL)
+            {
+                free(buffer);
+                errno = ENOMEM;
+                return(NULL);
+            }
+            buffer = grown;
+        }
+        *size += fread(buffer + *size,sizeof(uint8_t),capacity - *size,input);
+    } while(*size == capacity);
+    if(ferror(input))
+    {
+        free(buffer);
+        errno = EIO;
+        return(NULL);
+    }
+    memset(buffer + *size, 0, 2);
+    return buffer;
+}
+// openInput opens the file at path for reading, recognising gzip and zstd compressed regular files by their magic bytes
+// Compressed files are decompressed by a child gzip or zstd process writing into a pipe, so decompression runs alongside disassembly, the pipe bounds the memory in flight and no temporary file is written
+// openInput returns the stream to decode, or NULL with errno set if the file cannot be opened or its decompressor started, and sets decompressor to the child process id or 0 for uncompressed files
+// Descriptors are opened close-on-exec atomically, so decompressors started by other threads do not inherit them
+FILE *openInput(char *path, pid_t *decompressor)
+{
+    FILE *input;
+    struct stat info;
+    uint8_t magic[4] = {0, 0, 0, 0};
+    char *tool = NULL;
+    int pipeEnds[2];
+    int inputFd;
+    int error;
+
+    *decompressor = 0;
+    input = fopen(path,"rbe");
+    if(input == NULL)
+    {
+        return(NULL);
+    }
+    if(fstat(fileno(input), &info) != 0 || !S_ISREG(info.st_mode)) // Pipes and devices cannot be rewound after reading the magic bytes
+    {
+        return(input);
+    }
+    fread(magic,sizeof(uint8_t),4,input);
+    rewind(input);
+    if(magic[0] == 0x1f && magic[1] == 0x8b) // gzip
+    {
+        tool = "gzip";
+    }
+    else if(magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) // zstd
+    {
+        tool = "zstd";
+    }
+    if(tool == NULL)
+    {
+        return(input);
+    }
+
+    if(pipe2(pipeEnds, O_CLOEXEC) != 0)
+    {
+        error = errno;
+        fclose(input);
+        errno = error;
+        return(NULL);
+    }
+    inputFd = fileno(input);
+    *decompressor = fork();
+    if(*decompressor < 0)
+    {
+        error = errno;
+        close(pipeEnds[0]);
+        close(pipeEnds[1]);
+        fclose(input);
+        *decompressor = 0;
+        errno = error;
+        return(NULL);
+    }
+    if(*decompressor == 0) // Child: decompress the file on standard input into the pipe, making only async-signal-safe calls as the parent may have other threads
+    {
+        dup2(inputFd, STDIN_FILENO);
+        dup2(pipeEnds[1], STDOUT_FILENO);
+        close(pipeEnds[0]);
+        close(pipeEnds[1]);
+        lseek(STDIN_FILENO, 0L, SEEK_SET);
+        signal(SIGPIPE, SIG_DFL); // So closing the stream early ends the decompressor in a way closeInput recognises, even when the server ignores SIGPIPE
+        execlp(tool, tool, "-dc", (char *)NULL);
+        write(STDERR_FILENO, tool, strlen(tool));
+        write(STDERR_FILENO, ": cannot execute\n", 17);
+        _exit(127);
+    }
+    close(pipeEnds[1]);
+    fclose(input);
+    return(fdopen(pipeEnds[0],"rb"));
+}
+// closeInput closes a stream returned by openInput and reaps its decompressor
+// closeInput returns 0, or -1 if decompression failed
+// A stream may be closed before its end, which stops the decompressor with SIGPIPE: only the part that was read needed decompressing
+int closeInput(FILE *input, pid_t decompressor)
+{
+    int status;
+
+    fclose(input);
+    if(decompressor == 0)
+    {
+        return(0);
+    }
+    if(waitpid(decompressor, &status, 0) < 0)
+    {
+        return(-1);
+    }
+    if(WIFSIGNALED(status) && WTERMSIG(status) == SIGPIPE)
+    {
+        return(0);
+    }
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return(-1);
+    }
+    return(0);
+}
+// decodeStream disassembles input in chunks of CHUNK_SIZE bytes, so only one chunk is held in memory regardless of the size of the input
+// Unless image is NULL, the start of the input that fits in the address space above the listing's origin is also copied to image and its length to imageSize
+void decodeStream(Listing *list, FILE *input, uint8_t *image, int *imageSize)
 {
     uint8_t *buffer;
+    uint64_t location = 0;
+    int filled = 0;
+    int consumed;
+    int final = 0;
 
-    buffer = (uint8_t *)malloc(size);
+    buffer = (uint8_t *)malloc(CHUNK_SIZE + 2); // Two spare bytes hold zero operands for an instruction truncated by the end of input
     if(buffer == NULL)
     {
         fprintf(stderr,"Out of memory!\n");
         exit(99);
     }
-    fread(buffer,sizeof(uint8_t),size,input);
-    return buffer;
+    while(!final)
+    {
+        filled += fread(buffer + filled,sizeof(uint8_t),CHUNK_SIZE - filled,input);
+        if(filled < CHUNK_SIZE)
+        {
+            if(ferror(input))
+            {
+                fprintf(stderr,"%s\n",strerror(5));
+                exit(5);
+            }
+            final = 1;
+            memset(buffer + filled, 0, 2);
+        }
+        if(image != NULL && location < (uint64_t)(65536 - list->origin))
+        {
+            consumed = filled < (int)(65536 - list->origin - location) ? filled : (int)(65536 - list->origin - location);
+            memcpy(image + location, buffer, consumed);
+            *imageSize = location + consumed;
+        }
+        consumed = readBuffer(list, buffer, location, filled, final);
+        if(!final)
+        {
+            location += consumed;
+            filled -= consumed;
+            memmove(buffer, buffer + consumed, filled); // Carry an incomplete instruction over to the next chunk
+        }
+    }
+    free(buffer);
 }
-int findSize(FILE *input)
+// instLength returns the size in bytes of the instruction beginning with opcode
+int instLength(uint8_t opcode)
 {
-    int size;
-
-    fseek(input, 0L, SEEK_END);
-    size = ftell(input)*sizeof(int);
-    rewind(input);
-    return size;
+    switch(opcode)
+    {
+    case 0x01: case 0x11: case 0x21: case 0x31: // LXI
+    case 0x22: case 0x2a: case 0x32: case 0x3a: // SHLD, LHLD, STA, LDA
+    case 0xc2: case 0xc3: case 0xc4: case 0xca: case 0xcc: case 0xcd: // Jumps and calls
+    case 0xd2: case 0xd4: case 0xda: case 0xdc:
+    case 0xe2: case 0xe4: case 0xea: case 0xec:
+    case 0xf2: case 0xf4: case 0xfa: case 0xfc:
+        return(3);
+    case 0x06: case 0x0e: case 0x16: case 0x1e: case 0x26: case 0x2e: case 0x36: case 0x3e: // MVI
+    case 0xc6: case 0xce: case 0xd6: case 0xde: case 0xe6: case 0xee: case 0xf6: case 0xfe: // Immediate arithmetic and logic
+    case 0xd3: case 0xdb: // OUT, IN
+        return(2);
+    default:
+        return(1);
+    }
 }
-// printInstruction takes pointer to current location in file, integer of current location in file, integer of size of instruction in bytes, string of name of instruction, strings of registers or number parameters of instruction, and the type of parameter as defined above
+// printInstruction takes listing to print to, pointer to current location in file, integer of current location in file, integer of size of instruction in bytes, string of name of instruction, strings of registers or number parameters of instruction, and the type of parameter as defined above
 // printInstruction returns current value of location looping variable before next increment
-int printInstruction(uint8_t *buffer, int location, int instSize, char *instName, char *reg1, char *reg2, InstParam parameter)
+uint64_t printInstruction(Listing *list, uint8_t *buffer, uint64_t location, int instSize, char *instName, char *reg1, char *reg2, InstParam parameter)
 {
+    FILE *out = list->out;
     int i = 0;
-    printf("%04x ", location); // Print current location in file
+    fprintf(out, "%08" PRIx64 " ", location); // Print current location in file
+    fprintf(out, "%04x ", (uint16_t)(list->origin + location)); // Print CPU address of current location
     for(; i < instSize; i++) // Print bytes of instruction
     {
-        printf("%02x ", buffer[i]);
+        fprintf(out, "%02x ", buffer[i]);
     }
     for(i = 0; i < (3 - instSize)*3; i++) // Print additional padding spaces if instruction is 1 or 2 bytes
     {
-        putchar(' ');
+        fputc(' ', out);
     }
-    printf("%s", instName); // Print instruction name
+    fprintf(out, "%s", instName); // Print instruction name
     if(parameter != NO_PARAM) // Print extra spaces if instruction has parameter
     {
         if(strlen(instName) < 4) // Print additional padding spaces if instruction name is less than 4 characters
         {
             for(i = 0; i < (4 - strlen(instName)); i++)
             {
-                putchar(' ');
+                fputc(' ', out);
             }
         }
-        printf("   "); // Print minimum number of spaces between instruction name and instruction parameter
+        fprintf(out, "   "); // Print minimum number of spaces between instruction name and instruction parameter
     }
     switch(parameter) // Handle all parameter cases
     {
     case NO_PARAM: // Print nothing for no parameter
         break;
     case S_REG:
-        printf("%s", reg1); // Print register string
+        fprintf(out, "%s", reg1); // Print register string
         break;
     case REG_8BIT:
-        printf("%s,$%02x", reg1, buffer[1]); // Print register string and 8-bit immediate value
+        fprintf(out, "%s,$%02x", reg1, buffer[1]); // Print register string and 8-bit immediate value
         location++;
         buffer++;
         break;
     case REG_16BIT:
-        printf("%s,$%02x%02x", reg1, buffer[2], buffer[1]); // Print register string and 16-bit little endian immediate value
+        fprintf(out, "%s,$%02x%02x", reg1, buffer[2], buffer[1]); // Print register string and 16-bit little endian immediate value
         location += 2;
         buffer += 2;
         break;
     case REG_REG:
-        printf("%s,%s", reg1, reg2); // Print both register strings
+        fprintf(out, "%s,%s", reg1, reg2); // Print both register strings
         break;
     case S_8BIT:
-        printf("$%02x", buffer[1]); // Print 8-bit immediate value
+        fprintf(out, "$%02x", buffer[1]); // Print 8-bit immediate value
+        if(list->access != NULL)
+        {
+            noteAccess(list->access, buffer);
+        }
         location++;
         buffer++;
         break;
     case S_16BIT:
-        printf("$%02x%02x", buffer[2], buffer[1]); //Print little endian 16-bit immediate value
+        fprintf(out, "$%02x%02x", buffer[2], buffer[1]); //Print little endian 16-bit immediate value
+        if(list->map != NULL && (buffer[0] & 0xc0) == 0xc0) // Note the bank entered by calls and jumps to a trampoline
+        {
+            for(i = 0; i < list->map->trampolineCount; i++)
+            {
+                if(list->map->trampolines[i].address == (buffer[1] | buffer[2] << 8))
+                {
+                    fprintf(out, "   ; bank %x", list->map->trampolines[i].bank);
+                    break;
+                }
+            }
+        }
+        if(list->access != NULL)
+        {
+            noteAccess(list->access, buffer);
+        }
         location += 2;
         buffer += 2;
         break;
     }
-    putchar('\n');
+    fputc('\n', out);
     return(location);
 }
-void readBuffer(uint8_t *buffer, int size)
+// readBuffer prints the disassembly of size bytes of window to list, the first of which is at location in the file
+// Unless final is set, an instruction running past the end of window is left for the next call
+// readBuffer returns the number of bytes disassembled
+int readBuffer(Listing *list, uint8_t *window, uint64_t location, int size, int final)
 {
-    static uint8_t incIns1 = 0;
-    static int isIncIns1 = 0;
-    static uint8_t incIns2 [2] = {0, 0};
-    static int isIncIns2 = 0;
-    char inst[5];
-    int i = 0;
+    uint8_t *buffer;
+    uint64_t i = location;
 
-    for(; i < size; i++, buffer++)
+    for(; i < location + size; i++)
     {
+        buffer = window + (i - location); // Keep the byte pointer in step with i after multi-byte instructions
+        if(!final && i + instLength(*buffer) > location + size)
+        {
+            break;
+        }
         switch(*buffer)
         {
         case 0x00: // NOP
-            i = printInstruction(buffer, i, 1, "NOP", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "NOP", "", "", NO_PARAM);
             break;
         case 0x01: // LXI B,D16
-            i = printInstruction(buffer, i, 3, "LXI", "B", "", REG_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LXI", "B", "", REG_16BIT);
             break;
         case 0x02: // STAX B
-            i = printInstruction(buffer, i, 1, "STAX", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "STAX", "B", "", S_REG);
             break;
         case 0x03: // INX B
-            i = printInstruction(buffer, i, 1, "INX", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INX", "B", "", S_REG);
             break;
         case 0x04: // INR B
-            i = printInstruction(buffer, i, 1, "INR", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "B", "", S_REG);
             break;
         case 0x05: // DCR B
-            i = printInstruction(buffer, i, 1, "DCR", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "B", "", S_REG);
             break;
         case 0x06: // MVI B,D8
-            i = printInstruction(buffer, i, 2, "MVI", "B", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "B", "", REG_8BIT);
             break;
         case 0x07: // RLC
-            i = printInstruction(buffer, i, 1, "RLC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RLC", "", "", NO_PARAM);
             break;
         case 0x09: // DAD B
-            i = printInstruction(buffer, i, 1, "DAD", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DAD", "B", "", S_REG);
             break;
         case 0x0a: // LDAX B
-            i = printInstruction(buffer, i, 1, "LDAX", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "LDAX", "B", "", S_REG);
             break;
         case 0x0b: // DCX B
-            i = printInstruction(buffer, i, 1, "DCX", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCX", "B", "", S_REG);
             break;
         case 0x0c: // INR C
-            i = printInstruction(buffer, i, 1, "INR", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "C", "", S_REG);
             break;
         case 0x0d: // DCR C
-            i = printInstruction(buffer, i, 1, "DCR", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "C", "", S_REG);
             break;
         case 0x0e: // MVI C,D8
-            i = printInstruction(buffer, i, 2, "MVI", "C", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "C", "", REG_8BIT);
             break;
         case 0x0f: // RRC
-            i = printInstruction(buffer, i, 1, "RRC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RRC", "", "", NO_PARAM);
             break;
         case 0x11: // LXI D,D16
-            i = printInstruction(buffer, i, 3, "LXI", "D", "", REG_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LXI", "D", "", REG_16BIT);
             break;
         case 0x12: // STAX D
-            i = printInstruction(buffer, i, 1, "STAX", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "STAX", "D", "", S_REG);
             break;
         case 0x13: // INX D
-            i = printInstruction(buffer, i, 1, "INX", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INX", "D", "", S_REG);
             break;
         case 0x14: // INR D
-            i = printInstruction(buffer, i, 1, "INR", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "D", "", S_REG);
             break;
         case 0x15: // DCR D
-            i = printInstruction(buffer, i, 1, "DCR", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "D", "", S_REG);
             break;
         case 0x16: // MVI D,D8
-            i = printInstruction(buffer, i, 2, "MVI", "D", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "D", "", REG_8BIT);
             break;
         case 0x17: // RAL
-            i = printInstruction(buffer, i, 1, "RAL", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RAL", "", "", NO_PARAM);
             break;
         case 0x19: // DAD D
-            i = printInstruction(buffer, i, 1, "DAD", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DAD", "D", "", S_REG);
             break;
         case 0x1a: // LDAX D
-            i = printInstruction(buffer, i, 1, "LDAX", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "LDAX", "D", "", S_REG);
             break;
         case 0x1b: // DCX D
-            i = printInstruction(buffer, i, 1, "DCX", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCX", "D", "", S_REG);
             break;
         case 0x1c: // INR E
-            i = printInstruction(buffer, i, 1, "INR", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "E", "", S_REG);
             break;
         case 0x1d: // DCR E
-            i = printInstruction(buffer, i, 1, "DCR", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "E", "", S_REG);
             break;
         case 0x1e: // MVI E,D8
-            i = printInstruction(buffer, i, 2, "MVI", "E", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "E", "", REG_8BIT);
             break;
         case 0x1f: // RAR
-            i = printInstruction(buffer, i, 1, "RAR", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RAR", "", "", NO_PARAM);
             break;
         case 0x21: // LXI H,D16
-            i = printInstruction(buffer, i, 3, "LXI", "H", "", REG_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LXI", "H", "", REG_16BIT);
             break;
         case 0x22: // SHLD adr
-            i = printInstruction(buffer, i, 3, "SHLD", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "SHLD", "", "", S_16BIT);
             break;
         case 0x23: // INX H
-            i = printInstruction(buffer, i, 1, "INX", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INX", "H", "", S_REG);
             break;
         case 0x24: // INR H
-            i = printInstruction(buffer, i, 1, "INX", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INX", "H", "", S_REG);
             break;
         case 0x25: // DCR H
-            i = printInstruction(buffer, i, 1, "DCR", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "H", "", S_REG);
             break;
         case 0x26: // MVI H,D8
-            i = printInstruction(buffer, i, 2, "MVI", "H", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "H", "", REG_8BIT);
             break;
         case 0x27: // DAA
-            i = printInstruction(buffer, i, 1, "DAA", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "DAA", "", "", NO_PARAM);
             break;
         case 0x29: // DAD H
-            i = printInstruction(buffer, i, 1, "DAD", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DAD", "H", "", S_REG);
             break;
         case 0x2a: // LHLD adr
-            i = printInstruction(buffer, i, 3, "LHLD", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LHLD", "", "", S_16BIT);
             break;
         case 0x2b: // DCX H
-            i = printInstruction(buffer, i, 1, "DCX", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCX", "H", "", S_REG);
             break;
         case 0x2c: // INR L
-            i = printInstruction(buffer, i, 1, "INR", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "L", "", S_REG);
             break;
         case 0x2d: // DCR L
-            i = printInstruction(buffer, i, 1, "DCR", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "L", "", S_REG);
             break;
         case 0x2e: // MVI L,D8
-            i = printInstruction(buffer, i, 2, "MVI", "L", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "L", "", REG_8BIT);
             break;
         case 0x2f: // CMA
-            i = printInstruction(buffer, i, 1, "CMA", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "CMA", "", "", NO_PARAM);
             break;
         case 0x31: // LXI SP,D16
-            i = printInstruction(buffer, i, 3, "LXI", "SP", "", REG_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LXI", "SP", "", REG_16BIT);
             break;
         case 0x32: // STA adr
-            i = printInstruction(buffer, i, 3, "STA", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "STA", "", "", S_16BIT);
             break;
         case 0x33: // INX SP
-            i = printInstruction(buffer, i, 1, "INX", "SP", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INX", "SP", "", S_REG);
             break;
         case 0x34: // INR M
-            i = printInstruction(buffer, i, 1, "INR", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "M", "", S_REG);
             break;
         case 0x35: // DCR M
-            i = printInstruction(buffer, i, 1, "DCR", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "M", "", S_REG);
             break;
         case 0x36: // MVI M,D8
-            i = printInstruction(buffer, i, 2, "MVI", "M", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "M", "", REG_8BIT);
             break;
         case 0x37: // STC
-            i = printInstruction(buffer, i, 1, "STC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "STC", "", "", NO_PARAM);
             break;
         case 0x39: // DAD SP
-            i = printInstruction(buffer, i, 1, "DAD", "SP", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DAD", "SP", "", S_REG);
             break;
         case 0x3a: // LDA adr
-            i = printInstruction(buffer, i, 3, "LDA", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "LDA", "", "", S_16BIT);
             break;
         case 0x3b: // DCX SP
-            i = printInstruction(buffer, i, 1, "DCX", "SP", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCX", "SP", "", S_REG);
             break;
         case 0x3c: // INR A
-            i = printInstruction(buffer, i, 1, "INR", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "INR", "A", "", S_REG);
             break;
         case 0x3d: // DCR A
-            i = printInstruction(buffer, i, 1, "DCR", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "DCR", "A", "", S_REG);
             break;
         case 0x3e: // MVI A,D8
-            i = printInstruction(buffer, i, 2, "MVI", "A", "", REG_8BIT);
+            i = printInstruction(list, buffer, i, 2, "MVI", "A", "", REG_8BIT);
             break;
         case 0x3f: // CMC
-            i = printInstruction(buffer, i, 1, "CMC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "CMC", "", "", NO_PARAM);
             break;
         case 0x40: // MOV B,B
-            i = printInstruction(buffer, i, 1, "MOV", "B", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "B", REG_REG);
             break;
         case 0x41: // MOV B,C
-            i = printInstruction(buffer, i, 1, "MOV", "B", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "C", REG_REG);
             break;
         case 0x42: // MOV B,D
-            i = printInstruction(buffer, i, 1, "MOV", "B", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "D", REG_REG);
             break;
         case 0x43: // MOV B,E
-            i = printInstruction(buffer, i, 1, "MOV", "B", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "E", REG_REG);
             break;
         case 0x44: // MOV B,H
-            i = printInstruction(buffer, i, 1, "MOV", "B", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "H", REG_REG);
             break;
         case 0x45: // MOV B,L
-            i = printInstruction(buffer, i, 1, "MOV", "B", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "L", REG_REG);
             break;
         case 0x46: // MOV B,M
-            i = printInstruction(buffer, i, 1, "MOV", "B", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "M", REG_REG);
             break;
         case 0x47: // MOV B,A
-            i = printInstruction(buffer, i, 1, "MOV", "B", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "B", "A", REG_REG);
             break;
         case 0x48: // MOV C,B
-            i = printInstruction(buffer, i, 1, "MOV", "C", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "B", REG_REG);
             break;
         case 0x49: // MOV C,C
-            i = printInstruction(buffer, i, 1, "MOV", "C", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "C", REG_REG);
             break;
         case 0x4a: // MOV C,D
-            i = printInstruction(buffer, i, 1, "MOV", "C", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "D", REG_REG);
             break;
         case 0x4b: // MOV C,E
-            i = printInstruction(buffer, i, 1, "MOV", "C", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "E", REG_REG);
         break;
         case 0x4c: // MOV C,H
-            i = printInstruction(buffer, i, 1, "MOV", "C", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "H", REG_REG);
             break;
         case 0x4d: // MOV C,L
-            i = printInstruction(buffer, i, 1, "MOV", "C", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "L", REG_REG);
             break;
         case 0x4e: // MOV C,M
-            i = printInstruction(buffer, i, 1, "MOV", "C", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "M", REG_REG);
             break;
         case 0x4f: // MOV C,A
-            i = printInstruction(buffer, i, 1, "MOV", "C", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "C", "A", REG_REG);
             break;
         case 0x50: // MOV D,B
-            i = printInstruction(buffer, i, 1, "MOV", "D", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "B", REG_REG);
             break;
         case 0x51: // MOV D,C
-            i = printInstruction(buffer, i, 1, "MOV", "D", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "C", REG_REG);
             break;
         case 0x52: // MOV D,D
-            i = printInstruction(buffer, i, 1, "MOV", "D", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "D", REG_REG);
             break;
         case 0x53: // MOV D,E
-            i = printInstruction(buffer, i, 1, "MOV", "D", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "E", REG_REG);
             break;
         case 0x54: // MOV D,H
-            i = printInstruction(buffer, i, 1, "MOV", "D", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "H", REG_REG);
             break;
         case 0x55: // MOV D,L
-            i = printInstruction(buffer, i, 1, "MOV", "D", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "L", REG_REG);
             break;
         case 0x56: // MOV D,M
-            i = printInstruction(buffer, i, 1, "MOV", "D", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "M", REG_REG);
             break;
         case 0x57: // MOV D,A
-            i = printInstruction(buffer, i, 1, "MOV", "D", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "D", "A", REG_REG);
             break;
         case 0x58: // MOV E,B
-            i = printInstruction(buffer, i, 1, "MOV", "E", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "B", REG_REG);
             break;
         case 0x59: // MOV E,C
-            i = printInstruction(buffer, i, 1, "MOV", "E", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "C", REG_REG);
             break;
         case 0x5a: // MOV E,D
-            i = printInstruction(buffer, i, 1, "MOV", "E", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "D", REG_REG);
             break;
         case 0x5b: // MOV E,E
-            i = printInstruction(buffer, i, 1, "MOV", "E", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "E", REG_REG);
             break;
         case 0x5c: // MOV E,H
-            i = printInstruction(buffer, i, 1, "MOV", "E", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "H", REG_REG);
             break;
         case 0x5d: // MOV E,L
-            i = printInstruction(buffer, i, 1, "MOV", "E", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "L", REG_REG);
             break;
         case 0x5e: // MOV E,M
-            i = printInstruction(buffer, i, 1, "MOV", "E", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "M", REG_REG);
             break;
         case 0x5f: // MOV E,A
-            i = printInstruction(buffer, i, 1, "MOV", "E", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "E", "A", REG_REG);
             break;
         case 0x60: // MOV H,B
-            i = printInstruction(buffer, i, 1, "MOV", "H", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "B", REG_REG);
             break;
         case 0x61: // MOV H,C
-            i = printInstruction(buffer, i, 1, "MOV", "H", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "C", REG_REG);
             break;
         case 0x62: // MOV H,D
-            i = printInstruction(buffer, i, 1, "MOV", "H", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "D", REG_REG);
             break;
         case 0x63: // MOV H,E
-            i = printInstruction(buffer, i, 1, "MOV", "H", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "E", REG_REG);
             break;
         case 0x64: // MOV H,H
-            i = printInstruction(buffer, i, 1, "MOV", "H", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "H", REG_REG);
             break;
         case 0x65: // MOV H,L
-            i = printInstruction(buffer, i, 1, "MOV", "H", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "L", REG_REG);
             break;
         case 0x66: // MOV H,M
-            i = printInstruction(buffer, i, 1, "MOV", "H", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "M", REG_REG);
             break;
         case 0x67: // MOV H,A
-            i = printInstruction(buffer, i, 1, "MOV", "H", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "H", "A", REG_REG);
             break;
         case 0x68: // MOV L,B
-            i = printInstruction(buffer, i, 1, "MOV", "L", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "B", REG_REG);
             break;
         case 0x69: // MOV L,C
-            i = printInstruction(buffer, i, 1, "MOV", "L", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "C", REG_REG);
             break;
         case 0x6a: // MOV L,D
-            i = printInstruction(buffer, i, 1, "MOV", "L", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "D", REG_REG);
             break;
         case 0x6b: // MOV L,E
-            i = printInstruction(buffer, i, 1, "MOV", "L", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "E", REG_REG);
             break;
         case 0x6c: // MOV L,H
-            i = printInstruction(buffer, i, 1, "MOV", "L", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "H", REG_REG);
             break;
         case 0x6d: // MOV L,L
-            i = printInstruction(buffer, i, 1, "MOV", "L", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "L", REG_REG);
             break;
         case 0x6e: // MOV L,M
-            i = printInstruction(buffer, i, 1, "MOV", "L", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "M", REG_REG);
             break;
         case 0x6f: // MOV L,A
-            i = printInstruction(buffer, i, 1, "MOV", "L", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "L", "A", REG_REG);
             break;
         case 0x70: // MOV M,B
-            i = printInstruction(buffer, i, 1, "MOV", "M", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "B", REG_REG);
             break;
         case 0x71: // MOV M,C
-            i = printInstruction(buffer, i, 1, "MOV", "M", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "C", REG_REG);
             break;
         case 0x72: // MOV M,D
-            i = printInstruction(buffer, i, 1, "MOV", "M", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "D", REG_REG);
             break;
         case 0x73: // MOV M,E
-            i = printInstruction(buffer, i, 1, "MOV", "M", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "E", REG_REG);
             break;
         case 0x74: // MOV M,H
-            i = printInstruction(buffer, i, 1, "MOV", "M", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "H", REG_REG);
             break;
         case 0x75: // MOV M,L
-            i = printInstruction(buffer, i, 1, "MOV", "M", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "L", REG_REG);
             break;
         case 0x76: // HLT
-            i = printInstruction(buffer, i, 1, "HLT", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "HLT", "", "", NO_PARAM);
             break;
         case 0x77: // MOV M,A
-            i = printInstruction(buffer, i, 1, "MOV", "M", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "M", "A", REG_REG);
             break;
         case 0x78: // MOV A,B
-            i = printInstruction(buffer, i, 1, "MOV", "A", "B", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "B", REG_REG);
             break;
         case 0x79: // MOV A,C
-            i = printInstruction(buffer, i, 1, "MOV", "A", "C", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "C", REG_REG);
             break;
         case 0x7a: // MOV A,D
-            i = printInstruction(buffer, i, 1, "MOV", "A", "D", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "D", REG_REG);
             break;
         case 0x7b: // MOV A,E
-            i = printInstruction(buffer, i, 1, "MOV", "A", "E", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "E", REG_REG);
             break;
         case 0x7c: // MOV A,H
-            i = printInstruction(buffer, i, 1, "MOV", "A", "H", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "H", REG_REG);
             break;
         case 0x7d: // MOV A,L
-            i = printInstruction(buffer, i, 1, "MOV", "A", "L", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "L", REG_REG);
             break;
         case 0x7e: // MOV A,M
-            i = printInstruction(buffer, i, 1, "MOV", "A", "M", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "M", REG_REG);
             break;
         case 0x7f: // MOV A,A
-            i = printInstruction(buffer, i, 1, "MOV", "A", "A", REG_REG);
+            i = printInstruction(list, buffer, i, 1, "MOV", "A", "A", REG_REG);
             break;
         case 0x80: // ADD B
-            i = printInstruction(buffer, i, 1, "ADD", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "B", "", S_REG);
             break;
         case 0x81: // ADD C
-            i = printInstruction(buffer, i, 1, "ADD", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "C", "", S_REG);
             break;
         case 0x82: // ADD D
-            i = printInstruction(buffer, i, 1, "ADD", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "D", "", S_REG);
             break;
         case 0x83: // ADD E
-            i = printInstruction(buffer, i, 1, "ADD", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "E", "", S_REG);
             break;
         case 0x84: // ADD H
-            i = printInstruction(buffer, i, 1, "ADD", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "H", "", S_REG);
             break;
         case 0x85: // ADD L
-            i = printInstruction(buffer, i, 1, "ADD", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "L", "", S_REG);
             break;
         case 0x86: // ADD M
-            i = printInstruction(buffer, i, 1, "ADD", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "M", "", S_REG);
             break;
         case 0x87: // ADD A
-            i = printInstruction(buffer, i, 1, "ADD", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADD", "A", "", S_REG);
             break;
         case 0x88: // ADC B
-            i = printInstruction(buffer, i, 1, "ADC", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "B", "", S_REG);
             break;
         case 0x89: // ADC C
-            i = printInstruction(buffer, i, 1, "ADC", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "C", "", S_REG);
             break;
         case 0x8a: // ADC D
-            i = printInstruction(buffer, i, 1, "ADC", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "D", "", S_REG);
             break;
         case 0x8b: // ADC E
-            i = printInstruction(buffer, i, 1, "ADC", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "E", "", S_REG);
             break;
         case 0x8c: // ADC H
-            i = printInstruction(buffer, i, 1, "ADC", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "H", "", S_REG);
             break;
         case 0x8d: // ADC L
-            i = printInstruction(buffer, i, 1, "ADC", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "L", "", S_REG);
             break;
         case 0x8e: // ADC M
-            i = printInstruction(buffer, i, 1, "ADC", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "M", "", S_REG);
             break;
         case 0x8f: // ADC A
-            i = printInstruction(buffer, i, 1, "ADC", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ADC", "A", "", S_REG);
             break;
         case 0x90: // SUB B
-            i = printInstruction(buffer, i, 1, "SUB", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "B", "", S_REG);
             break;
         case 0x91: // SUB C
-            i = printInstruction(buffer, i, 1, "SUB", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "C", "", S_REG);
             break;
         case 0x92: // SUB D
-            i = printInstruction(buffer, i, 1, "SUB", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "D", "", S_REG);
             break;
         case 0x93: // SUB E
-            i = printInstruction(buffer, i, 1, "SUB", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "E", "", S_REG);
             break;
         case 0x94: // SUB H
-            i = printInstruction(buffer, i, 1, "SUB", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "H", "", S_REG);
             break;
         case 0x95: // SUB L
-            i = printInstruction(buffer, i, 1, "SUB", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "L", "", S_REG);
             break;
         case 0x96: // SUB M
-            i = printInstruction(buffer, i, 1, "SUB", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "M", "", S_REG);
             break;
         case 0x97: // SUB A
-            i = printInstruction(buffer, i, 1, "SUB", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SUB", "A", "", S_REG);
             break;
         case 0x98: // SBB B
-            i = printInstruction(buffer, i, 1, "SBB", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "B", "", S_REG);
             break;
         case 0x99: // SBB C
-            i = printInstruction(buffer, i, 1, "SBB", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "C", "", S_REG);
             break;
         case 0x9a: // SBB D
-            i = printInstruction(buffer, i, 1, "SBB", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "D", "", S_REG);
             break;
         case 0x9b: // SBB E
-            i = printInstruction(buffer, i, 1, "SBB", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "E", "", S_REG);
             break;
         case 0x9c: // SBB H
-            i = printInstruction(buffer, i, 1, "SBB", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "H", "", S_REG);
             break;
         case 0x9d: // SBB L
-            i = printInstruction(buffer, i, 1, "SBB", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "L", "", S_REG);
             break;
         case 0x9e: // SBB M
-            i = printInstruction(buffer, i, 1, "SBB", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "M", "", S_REG);
             break;
         case 0x9f: // SBB A
-            i = printInstruction(buffer, i, 1, "SBB", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "SBB", "A", "", S_REG);
             break;
         case 0xa0: // ANA B
-            i = printInstruction(buffer, i, 1, "ANA", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "B", "", S_REG);
             break;
         case 0xa1: // ANA C
-            i = printInstruction(buffer, i, 1, "ANA", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "C", "", S_REG);
             break;
         case 0xa2: // ANA D
-            i = printInstruction(buffer, i, 1, "ANA", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "D", "", S_REG);
             break;
         case 0xa3: // ANA E
-            i = printInstruction(buffer, i, 1, "ANA", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "E", "", S_REG);
             break;
         case 0xa4: // ANA H
-            i = printInstruction(buffer, i, 1, "ANA", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "H", "", S_REG);
             break;
         case 0xa5: // ANA L
-            i = printInstruction(buffer, i, 1, "ANA", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "L", "", S_REG);
             break;
         case 0xa6: // ANA M
-            i = printInstruction(buffer, i, 1, "ANA", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "M", "", S_REG);
             break;
         case 0xa7: // ANA A
-            i = printInstruction(buffer, i, 1, "ANA", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ANA", "A", "", S_REG);
             break;
         case 0xa8: // XRA B
-            i = printInstruction(buffer, i, 1, "XRA", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "B", "", S_REG);
             break;
         case 0xa9: // XRA C
-            i = printInstruction(buffer, i, 1, "XRA", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "C", "", S_REG);
             break;
         case 0xaa: // XRA D
-            i = printInstruction(buffer, i, 1, "XRA", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "D", "", S_REG);
             break;
         case 0xab: // XRA E
-            i = printInstruction(buffer, i, 1, "XRA", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "E", "", S_REG);
             break;
         case 0xac: // XRA H
-            i = printInstruction(buffer, i, 1, "XRA", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "H", "", S_REG);
             break;
         case 0xad: // XRA L
-            i = printInstruction(buffer, i, 1, "XRA", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "L", "", S_REG);
             break;
         case 0xae: // XRA M
-            i = printInstruction(buffer, i, 1, "XRA", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "M", "", S_REG);
             break;
         case 0xaf: // XRA A
-            i = printInstruction(buffer, i, 1, "XRA", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "XRA", "A", "", S_REG);
             break;
         case 0xb0: // ORA B
-            i = printInstruction(buffer, i, 1, "ORA", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "B", "", S_REG);
             break;
         case 0xb1: // ORA C
-            i = printInstruction(buffer, i, 1, "ORA", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "C", "", S_REG);
             break;
         case 0xb2: // ORA D
-            i = printInstruction(buffer, i, 1, "ORA", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "D", "", S_REG);
             break;
         case 0xb3: // ORA E
-            i = printInstruction(buffer, i, 1, "ORA", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "E", "", S_REG);
             break;
         case 0xb4: // ORA H
-            i = printInstruction(buffer, i, 1, "ORA", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "H", "", S_REG);
             break;
         case 0xb5: // ORA L
-            i = printInstruction(buffer, i, 1, "ORA", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "L", "", S_REG);
             break;
         case 0xb6: // ORA M
-            i = printInstruction(buffer, i, 1, "ORA", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "M", "", S_REG);
             break;
         case 0xb7: // ORA A
-            i = printInstruction(buffer, i, 1, "ORA", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "ORA", "A", "", S_REG);
             break;
         case 0xb8: // CMP B
-            i = printInstruction(buffer, i, 1, "CMP", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "B", "", S_REG);
             break;
         case 0xb9: // CMP C
-            i = printInstruction(buffer, i, 1, "CMP", "C", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "C", "", S_REG);
             break;
         case 0xba: // CMP D
-            i = printInstruction(buffer, i, 1, "CMP", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "D", "", S_REG);
             break;
         case 0xbb: // CMP E
-            i = printInstruction(buffer, i, 1, "CMP", "E", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "E", "", S_REG);
             break;
         case 0xbc: // CMP H
-            i = printInstruction(buffer, i, 1, "CMP", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "H", "", S_REG);
             break;
         case 0xbd: // CMP L
-            i = printInstruction(buffer, i, 1, "CMP", "L", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "L", "", S_REG);
             break;
         case 0xbe: // CMP M
-            i = printInstruction(buffer, i, 1, "CMP", "M", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "M", "", S_REG);
             break;
         case 0xbf: // CMP A
-            i = printInstruction(buffer, i, 1, "CMP", "A", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "CMP", "A", "", S_REG);
             break;
         case 0xc0: // RNZ
-            i = printInstruction(buffer, i, 1, "RNZ", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RNZ", "", "", NO_PARAM);
             break;
         case 0xc1: // POP B
-            i = printInstruction(buffer, i, 1, "POP", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "POP", "B", "", S_REG);
             break;
         case 0xc2: // JNZ adr
-            i = printInstruction(buffer, i, 3, "JNZ", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JNZ", "", "", S_16BIT);
             break;
         case 0xc3: // JMP adr
-            i = printInstruction(buffer, i, 3, "JMP", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JMP", "", "", S_16BIT);
             break;
         case 0xc4: // CNZ adr
-            i = printInstruction(buffer, i, 3, "CNZ", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CNZ", "", "", S_16BIT);
             break;
         case 0xc5: // PUSH B
-            i = printInstruction(buffer, i, 1, "PUSH", "B", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "PUSH", "B", "", S_REG);
             break;
         case 0xc6: // ADI D8
-            i = printInstruction(buffer, i, 2, "ADI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "ADI", "", "", S_8BIT);
             break;
         case 0xc7: // RST 0
-            i = printInstruction(buffer, i, 1, "RST", "0", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "0", "", S_REG);
             break;
         case 0xc8: // RZ
-            i = printInstruction(buffer, i, 1, "RZ", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RZ", "", "", NO_PARAM);
             break;
         case 0xc9: // RET
-            i = printInstruction(buffer, i, 1, "RET", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RET", "", "", NO_PARAM);
             break;
         case 0xca: // JZ adr
-            i = printInstruction(buffer, i, 3, "JZ", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JZ", "", "", S_16BIT);
             break;
         case 0xcc: // CZ adr
-            i = printInstruction(buffer, i, 3, "CZ", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CZ", "", "", S_16BIT);
             break;
         case 0xcd: // CALL adr
-            i = printInstruction(buffer, i, 3, "CALL", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CALL", "", "", S_16BIT);
             break;
         case 0xce: // ACI D8
-            i = printInstruction(buffer, i, 2, "ACI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "ACI", "", "", S_8BIT);
             break;
         case 0xcf: // RST 1
-            i = printInstruction(buffer, i, 1, "RST", "", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "", "", S_REG);
             break;
         case 0xd0: // RNC
-            i = printInstruction(buffer, i, 1, "RNC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RNC", "", "", NO_PARAM);
             break;
         case 0xd1: // POP D
-            i = printInstruction(buffer, i, 1, "POP", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "POP", "D", "", S_REG);
             break;
         case 0xd2: // JNC adr
-            i = printInstruction(buffer, i, 3, "JNC", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JNC", "", "", S_16BIT);
             break;
         case 0xd3: // OUT D8
-            i = printInstruction(buffer, i, 2, "OUT", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "OUT", "", "", S_8BIT);
             break;
         case 0xd4: // CNC adr
-            i = printInstruction(buffer, i, 3, "CNC", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CNC", "", "", S_16BIT);
             break;
         case 0xd5: // PUSH D
-            i = printInstruction(buffer, i, 1, "PUSH", "D", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "PUSH", "D", "", S_REG);
             break;
         case 0xd6: // SUI D8
-            i = printInstruction(buffer, i, 2, "SUI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "SUI", "", "", S_8BIT);
             break;
         case 0xd7: // RST 2
-            i = printInstruction(buffer, i, 1, "RST", "2", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "2", "", S_REG);
             break;
         case 0xd8: // RC
-            i = printInstruction(buffer, i, 1, "RC", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RC", "", "", NO_PARAM);
             break;
         case 0xda: // JC adr
-            i = printInstruction(buffer, i, 3, "JC", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JC", "", "", S_16BIT);
             break;
         case 0xdb: // IN D8
-            i = printInstruction(buffer, i, 2, "IN", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "IN", "", "", S_8BIT);
             break;
         case 0xdc: // CC adr
-            i = printInstruction(buffer, i, 3, "CC", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CC", "", "", S_16BIT);
             break;
         case 0xde: // SBI D8
-            i = printInstruction(buffer, i, 2, "SBI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "SBI", "", "", S_8BIT);
             break;
         case 0xdf: // RST 3
-            i = printInstruction(buffer, i, 1, "RST", "3", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "3", "", S_REG);
             break;
         case 0xe0: // RPO
-            i = printInstruction(buffer, i, 1, "RPO", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RPO", "", "", NO_PARAM);
             break;
         case 0xe1: // POP H
-            i = printInstruction(buffer, i, 1, "POP", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "POP", "H", "", S_REG);
             break;
         case 0xe2: // JPO adr
-            i = printInstruction(buffer, i, 3, "JPO", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JPO", "", "", S_16BIT);
             break;
         case 0xe3: // XTHL
-            i = printInstruction(buffer, i, 1, "XTHL", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "XTHL", "", "", NO_PARAM);
             break;
         case 0xe4: // CPO adr
-            i = printInstruction(buffer, i, 3, "CPO", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CPO", "", "", S_16BIT);
             break;
         case 0xe5: // PUSH H
-            i = printInstruction(buffer, i, 1, "PUSH", "H", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "PUSH", "H", "", S_REG);
             break;
         case 0xe6: // ANI D8
-            i = printInstruction(buffer, i, 2, "ANI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "ANI", "", "", S_8BIT);
             break;
         case 0xe7: // RST 4
-            i = printInstruction(buffer, i, 1, "RST", "4", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "4", "", S_REG);
             break;
         case 0xe8: // RPE
-            i = printInstruction(buffer, i, 1, "RPE", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RPE", "", "", NO_PARAM);
             break;
         case 0xe9: // PCHL
-            i = printInstruction(buffer, i, 1, "PCHL", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "PCHL", "", "", NO_PARAM);
             break;
         case 0xea: // JPE adr
-            i = printInstruction(buffer, i, 3, "JPE", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JPE", "", "", S_16BIT);
             break;
         case 0xeb: // XCHG
-            i = printInstruction(buffer, i, 1, "XCHG", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "XCHG", "", "", NO_PARAM);
             break;
         case 0xec: // CPE adr
-            i = printInstruction(buffer, i, 3, "CPE", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CPE", "", "", S_16BIT);
             break;
         case 0xee: // XRI D8
-            i = printInstruction(buffer, i, 2, "XRI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "XRI", "", "", S_8BIT);
             break;
         case 0xef: // RST 5
-            i = printInstruction(buffer, i, 1, "RST", "5", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "5", "", S_REG);
             break;
         case 0xf0: // RP
-            i = printInstruction(buffer, i, 1, "RP", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RP", "", "", NO_PARAM);
             break;
         case 0xf1: // POP PSW
-            i = printInstruction(buffer, i, 1, "POP", "PSW", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "POP", "PSW", "", S_REG);
             break;
         case 0xf2: // JP adr
-            i = printInstruction(buffer, i, 3, "JP", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JP", "", "", S_16BIT);
             break;
         case 0xf3: // DI
-            i = printInstruction(buffer, i, 1, "DI", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "DI", "", "", NO_PARAM);
             break;
         case 0xf4: // CP adr
-            i = printInstruction(buffer, i, 3, "CP", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CP", "", "", S_16BIT);
             break;
         case 0xf5: // PUSH PSW
-            i = printInstruction(buffer, i, 1, "PUSH", "PSW", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "PUSH", "PSW", "", S_REG);
             break;
         case 0xf6: // ORI D8
-            i = printInstruction(buffer, i, 2, "ORI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "ORI", "", "", S_8BIT);
             break;
         case 0xf7: // RST 6
-            i = printInstruction(buffer, i, 1, "RST", "6", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "6", "", S_REG);
             break;
         case 0xf8: // RM
-            i = printInstruction(buffer, i, 1, "RM", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "RM", "", "", NO_PARAM);
             break;
         case 0xf9: // SPHL
-            i = printInstruction(buffer, i, 1, "SPHL", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "SPHL", "", "", NO_PARAM);
             break;
         case 0xfa: // JM adr
-            i = printInstruction(buffer, i, 3, "JM", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "JM", "", "", S_16BIT);
             break;
         case 0xfb: // EI
-            i = printInstruction(buffer, i, 1, "EI", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "EI", "", "", NO_PARAM);
             break;
         case 0xfc: // CM adr
-            i = printInstruction(buffer, i, 3, "CM", "", "", S_16BIT);
+            i = printInstruction(list, buffer, i, 3, "CM", "", "", S_16BIT);
             break;
         case 0xfe: // CPI D8
-            i = printInstruction(buffer, i, 2, "CPI", "", "", S_8BIT);
+            i = printInstruction(list, buffer, i, 2, "CPI", "", "", S_8BIT);
             break;
         case 0xff: // RST 7
-            i = printInstruction(buffer, i, 1, "RST", "7", "", S_REG);
+            i = printInstruction(list, buffer, i, 1, "RST", "7", "", S_REG);
             break;
         default: // Undefined instructions
-            i = printInstruction(buffer, i, 1, "--", "", "", NO_PARAM);
+            i = printInstruction(list, buffer, i, 1, "--", "", "", NO_PARAM);
+        }
+    }
+    return(i - location);
+}
+
+/*
+The server keeps images loaded and decoded between requests and answers one request per line on a Unix domain socket
+Addresses are hexadecimal file locations and every response ends with a line holding a single '.'
+LIST path start end    disassembly of the instructions from the one containing start up to end
+AT path address        the instruction containing address
+XREF path address      the instructions whose 16-bit operand is address
+Failed requests are answered with '?' followed by the reason
+*/
+void serve(char *socketPath, size_t limit)
+{
+    struct sockaddr_un address;
+    struct stat info;
+    pthread_t thread;
+    intptr_t client;
+    int listener;
+
+    cacheLimit = limit;
+    signal(SIGPIPE, SIG_IGN); // A client hanging up must not stop the server
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path))
+    {
+        // file name too long
+        fprintf(stderr,"%s\n",strerror(36));
+        exit(36);
+    }
+    strcpy(address.sun_path, socketPath);
+    if(lstat(socketPath, &info) == 0) // Replace the socket left by an earlier server, but nothing else
+    {
+        if(!S_ISSOCK(info.st_mode))
+        {
+            // file exists
+            fprintf(stderr,"%s: %s\n",socketPath,strerror(17));
+            exit(17);
+        }
+        unlink(socketPath);
+    }
+    listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listener < 0 || bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+    {
+        fprintf(stderr,"%s\n",strerror(errno));
+        exit(errno);
+    }
+    for(;;)
+    {
+        client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if(client < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) // Out of descriptors or memory for now, so wait for clients to finish
+            {
+                sleep(1);
+                continue;
+            }
+            fprintf(stderr,"%s\n",strerror(errno));
+            exit(errno);
+        }
+        if(pthread_create(&thread, NULL, serveClient, (void *)client) != 0)
+        {
+            close(client);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+// serveClient answers requests from the connected socket passed as arg until the client hangs up
+void *serveClient(void *arg)
+{
+    int client = (int)(intptr_t)arg;
+    FILE *in = fdopen(client,"r");
+    FILE *out = fdopen(fcntl(client, F_DUPFD_CLOEXEC, 0),"w");
+    Listing list = {out, 0, NULL, NULL};
+    char line[4096];
+    char command[8];
+    char path[4096];
+    unsigned int start;
+    unsigned int end;
+    int fields;
+    int location;
+    int low, high, middle;
+    Image *image;
+
+    while(in != NULL && out != NULL && fgets(line, sizeof(line), in) != NULL)
+    {
+        fields = sscanf(line, "%7s %4095s %x %x", command, path, &start, &end);
+        if(fields < 3 || (strcmp(command,"LIST") == 0 && fields < 4) || (strcmp(command,"LIST") != 0 && strcmp(command,"AT") != 0 && strcmp(command,"XREF") != 0))
+        {
+            fprintf(out,"? %s\n.\n",strerror(22));
+            fflush(out);
+            continue;
+        }
+        image = acquireImage(path);
+        if(image == NULL)
+        {
+            fprintf(out,"? %s\n.\n",strerror(errno));
+            fflush(out);
+            continue;
+        }
+        if(strcmp(command,"LIST") == 0)
+        {
+            location = instructionAt(image, start);
+            if(location >= 0 && end >= start)
+            {
+                if(end >= (unsigned int)image->size)
+                {
+                    end = image->size - 1;
+                }
+                readBuffer(&list, image->bytes + location, location, end + 1 - location, 1);
+            }
+        }
+        else if(strcmp(command,"AT") == 0)
+        {
+            location = instructionAt(image, start);
+            if(location >= 0)
+            {
+                readBuffer(&list, image->bytes + location, location, 1, 1);
+            }
+        }
+        else if(strcmp(command,"XREF") == 0)
+        {
+            // Binary search for the first reference to start, then print every reference to it
+            low = 0;
+            high = image->xrefCount;
+            while(low < high)
+            {
+                middle = low + (high - low) / 2;
+                if(image->xrefs[middle].to < (int)start)
+                {
+                    low = middle + 1;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+            for(; low < image->xrefCount && image->xrefs[low].to == (int)start; low++)
+            {
+                location = image->xrefs[low].from;
+                readBuffer(&list, image->bytes + location, location, 1, 1);
+            }
+        }
+        releaseImage(image);
+        fprintf(out,".\n");
+        fflush(out);
+    }
+    if(in != NULL)
+    {
+        fclose(in);
+    }
+    else
+    {
+        close(client);
+    }
+    if(out != NULL)
+    {
+        fclose(out);
+    }
+    return(NULL);
+}
+// loadImage reads the file at path, which info describes, and decodes its instruction boundaries and cross references
+// loadImage returns the new image, or NULL with errno set if the file cannot be read
+Image *loadImage(char *path, struct stat *info)
+{
+    FILE *input;
+    pid_t decompressor;
+    Image *image;
+    int i;
+    int length;
+    int error;
+
+    input = openInput(path, &decompressor);
+    if(input == NULL)
+    {
+        return(NULL);
+    }
+    image = (Image *)calloc(1, sizeof(Image));
+    if(image == NULL)
+    {
+        closeInput(input, decompressor);
+        errno = ENOMEM;
+        return(NULL);
+    }
+    image->bytes = fillBuffer(input, &image->size);
+    if(image->bytes == NULL)
+    {
+        error = errno;
+        closeInput(input, decompressor);
+        free(image);
+        errno = error;
+        return(NULL);
+    }
+    if(closeInput(input, decompressor) != 0)
+    {
+        free(image->bytes);
+        free(image);
+        errno = EIO;
+        return(NULL);
+    }
+    image->path = strdup(path);
+    image->device = info->st_dev;
+    image->inode = info->st_ino;
+    image->modified = info->st_mtime;
+    image->starts = (uint8_t *)calloc(image->size / 8 + 1, sizeof(uint8_t));
+    image->xrefs = (XRef *)malloc((image->size / 3 + 1) * sizeof(XRef)); // At most one reference per three bytes
+    if(image->path == NULL || image->starts == NULL || image->xrefs == NULL)
+    {
+        freeImage(image);
+        errno = ENOMEM;
+        return(NULL);
+    }
+    for(i = 0; i < image->size; i += length)
+    {
+        image->starts[i / 8] |= 1 << (i % 8);
+        length = instLength(image->bytes[i]);
+        if(length == 3)
+        {
+            image->xrefs[image->xrefCount].to = image->bytes[i + 1] | image->bytes[i + 2] << 8;
+            image->xrefs[image->xrefCount].from = i;
+            image->xrefCount++;
+        }
+    }
+    qsort(image->xrefs, image->xrefCount, sizeof(XRef), compareXRef);
+    image->footprint = sizeof(Image) + image->size + 2 + image->size / 8 + 1 + image->xrefCount * sizeof(XRef);
+    return(image);
+}
+void freeImage(Image *image)
+{
+    free(image->path);
+    free(image->bytes);
+    free(image->starts);
+    free(image->xrefs);
+    free(image);
+}
+// acquireImage returns the cached image of the file at path, loading it if it is not cached or has changed since it was loaded
+// The image stays loaded until it is passed to releaseImage, or NULL is returned with errno set if the file cannot be read
+Image *acquireImage(char *path)
+{
+    struct stat info;
+    Image *image;
+    Image *loaded;
+
+    if(stat(path, &info) != 0)
+    {
+        return(NULL);
+    }
+    pthread_mutex_lock(&cacheLock);
+    for(image = cache; image != NULL; image = image->next)
+    {
+        if(image->stale || image->device != info.st_dev || image->inode != info.st_ino)
+        {
+            continue;
+        }
+        if(image->modified != info.st_mtime)
+        {
+            image->stale = 1; // Dropped once no client is using it
+            continue;
+        }
+        image->users++;
+        image->lastUse = ++cacheClock;
+        pthread_mutex_unlock(&cacheLock);
+        return(image);
+    }
+    pthread_mutex_unlock(&cacheLock);
+
+    // Decode outside the lock so other clients are not held up, then use whichever copy reached the cache first
+    loaded = loadImage(path, &info);
+    if(loaded == NULL)
+    {
+        return(NULL);
+    }
+    pthread_mutex_lock(&cacheLock);
+    for(image = cache; image != NULL; image = image->next)
+    {
+        if(!image->stale && image->device == info.st_dev && image->inode == info.st_ino && image->modified == info.st_mtime)
+        {
+            break;
+        }
+    }
+    if(image == NULL)
+    {
+        image = loaded;
+        loaded = NULL;
+        image->next = cache;
+        cache = image;
+        cacheUsed += image->footprint;
+    }
+    image->users++;
+    image->lastUse = ++cacheClock;
+    evictImages();
+    pthread_mutex_unlock(&cacheLock);
+    if(loaded != NULL)
+    {
+        freeImage(loaded);
+    }
+    return(image);
+}
+void releaseImage(Image *image)
+{
+    pthread_mutex_lock(&cacheLock);
+    image->users--;
+    evictImages();
+    pthread_mutex_unlock(&cacheLock);
+}
+// evictImages frees stale images and then least recently used images until the cache is within its limit, skipping images in use
+// evictImages must be called with cacheLock held
+void evictImages(void)
+{
+    Image **link;
+    Image **oldest;
+    Image *evicted;
+
+    for(;;)
+    {
+        oldest = NULL;
+        for(link = &cache; *link != NULL; link = &(*link)->next)
+        {
+            if((*link)->users > 0)
+            {
+                continue;
+            }
+            if((*link)->stale)
+            {
+                oldest = link;
+                break;
+            }
+            if(cacheUsed > cacheLimit && (oldest == NULL || (*link)->lastUse < (*oldest)->lastUse))
+            {
+                oldest = link;
+            }
+        }
+        if(oldest == NULL)
+        {
+            return;
+        }
+        evicted = *oldest;
+        *oldest = evicted->next;
+        cacheUsed -= evicted->footprint;
+        freeImage(evicted);
+    }
+}
+// instructionAt returns the location of the instruction containing location in image, or -1 if location is outside image
+int instructionAt(Image *image, int location)
+{
+    if(location < 0 || location >= image->size)
+    {
+        return(-1);
+    }
+    while(!(image->starts[location / 8] & 1 << (location % 8)))
+    {
+        location--;
+    }
+    return(location);
+}
+int compareXRef(const void *a, const void *b)
+{
+    const XRef *x = (const XRef *)a;
+    const XRef *y = (const XRef *)b;
+
+    if(x->to != y->to)
+    {
+        return(x->to < y->to ? -1 : 1);
+    }
+    return(x->from - y->from);
+}
+
+/*
+analyseFlow loads size bytes of image at CPU address origin and follows control flow from its entry points, propagating constant register values
+The entry points are the reset and interrupt vectors of an image loaded at 0000, otherwise origin itself
+Targets of PCHL, and of RET after a constant was pushed, are resolved from the propagated values and followed in turn
+Entry states are merged where paths join and revisited until none changes, which also carries constants through loops
+*/
+Flow *analyseFlow(uint8_t *image, int size, uint16_t origin)
+{
+    Flow *flow;
+    RegState reset;
+    int location;
+    int visited;
+
+    flow = (Flow *)calloc(1, sizeof(Flow));
+    if(flow == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    flow->start = origin;
+    flow->end = origin + size > 65536 ? 65536 : origin + size;
+    memcpy(flow->memory + flow->start, image, flow->end - flow->start);
+    memset(&reset, 0, sizeof(reset)); // Every register V_UNKNOWN and nothing on the stack
+    for(location = 0; location < 0x40; location += 8) // Reset and the RST 1 to RST 7 interrupt vectors
+    {
+        propagate(flow, origin == 0 ? location : origin, &reset);
+    }
+    do
+    {
+        visited = 0;
+        for(location = flow->start; location < flow->end; location++)
+        {
+            if(flow->pending[location / 8] == 0)
+            {
+                location |= 7; // Skip a byte of the bitmap with nothing pending
+                continue;
+            }
+            if(BIT_TEST(flow->pending, location))
+            {
+                BIT_CLEAR(flow->pending, location);
+                visit(flow, location);
+                visited = 1;
+            }
+        }
+    } while(visited);
+    return(flow);
+}
+// visit passes the entry state of the instruction at location on to every instruction that can follow it
+void visit(Flow *flow, int location)
+{
+    RegState state = flow->state[location];
+    RegState next;
+    uint8_t *inst = flow->memory + location;
+    uint8_t opcode = *inst;
+    uint16_t targets[TABLE_LIMIT];
+    int count;
+    int table;
+    int i;
+
+    if(opcode == 0xcd || (opcode & 0xc7) == 0xc4 || (opcode & 0xc7) == 0xc7) // CALL, Ccc and RST
+    {
+        next = state;
+        if(next.depth == STACK_DEPTH)
+        {
+            next.depth--;
+        }
+        memmove(next.stack[1], next.stack[0], next.depth * sizeof(next.stack[0]));
+        next.stack[0][0].kind = V_RETURN;
+        next.stack[0][1].kind = V_RETURN;
+        next.depth++;
+        propagate(flow, (opcode & 0xc7) == 0xc7 ? opcode & 0x38 : inst[1] | inst[2] << 8, &next);
+        next = state;
+        memset(next.reg, 0, sizeof(next.reg)); // The routine called may change any register
+        propagate(flow, location + instLength(opcode), &next);
+    }
+    else if(opcode == 0xc3 || (opcode & 0xc7) == 0xc2) // JMP and Jcc
+    {
+        propagate(flow, inst[1] | inst[2] << 8, &state);
+        if(opcode != 0xc3)
+        {
+            propagate(flow, location + 3, &state);
+        }
+    }
+    else if(opcode == 0xc9 || (opcode & 0xc7) == 0xc0) // RET and Rcc
+    {
+        if(opcode != 0xc9)
+        {
+            propagate(flow, location + 1, &state);
+        }
+        count = jumpTargets(flow, location, &state, targets, &table);
+        if(count > 0)
+        {
+            next = state;
+            next.depth--;
+            memmove(next.stack[0], next.stack[1], next.depth * sizeof(next.stack[0]));
+            propagate(flow, targets[0], &next);
+        }
+    }
+    else if(opcode == 0xe9) // PCHL
+    {
+        count = jumpTargets(flow, location, &state, targets, &table);
+        for(i = 0; i < count; i++)
+        {
+            propagate(flow, targets[i], &state);
+        }
+    }
+    else
+    {
+        transfer(flow, &state, inst);
+        propagate(flow, location + instLength(opcode), &state);
+    }
+}
+// propagate merges state into the entry state of the instruction at location, queueing it to be visited if that changed
+void propagate(Flow *flow, int location, RegState *state)
+{
+    RegState *entry = &flow->state[location];
+    Value *a;
+    Value *b;
+    int changed = 0;
+    int i;
+
+    if(!INSIDE(flow, location))
+    {
+        return;
+    }
+    if(!BIT_TEST(flow->code, location))
+    {
+        *entry = *state;
+        BIT_SET(flow->code, location);
+        BIT_SET(flow->pending, location);
+        return;
+    }
+    if(state->depth < entry->depth)
+    {
+        entry->depth = state->depth;
+        changed = 1;
+    }
+    // Registers then stack entries, any value differing between the paths becomes unknown
+    for(i = 0; i < 8 + entry->depth * 2; i++)
+    {
+        a = i < 8 ? &entry->reg[i] : &entry->stack[(i - 8) / 2][i % 2];
+        b = i < 8 ? &state->reg[i] : &state->stack[(i - 8) / 2][i % 2];
+        if(a->kind != V_UNKNOWN && (a->kind != b->kind || a->value != b->value))
+        {
+            a->kind = V_UNKNOWN;
+            changed = 1;
+        }
+    }
+    if(changed)
+    {
+        BIT_SET(flow->pending, location);
+    }
+}
+// transfer updates state for the effect of the instruction inst, which must not transfer control
+void transfer(Flow *flow, RegState *state, uint8_t *inst)
+{
+    uint8_t opcode = *inst;
+    int dest = (opcode >> 3) & 7;
+    Value *high = &state->reg[((opcode >> 4) & 3) * 2]; // Register pair encoded in bits 4 and 5
+    Value *low = high + 1;
+    Value *h = &state->reg[4];
+    Value *l = &state->reg[5];
+    Value swap[2];
+    uint16_t address = inst[1] | inst[2] << 8;
+    int sum;
+
+    if(opcode >= 0x40 && opcode < 0x80) // MOV
+    {
+        if(dest == 6) // Stores to memory are not tracked
+        {
+            return;
+        }
+        if((opcode & 7) != 6)
+        {
+            state->reg[dest] = state->reg[opcode & 7];
+        }
+        else if(h->kind == V_CONST && l->kind == V_CONST && INSIDE(flow, h->value << 8 | l->value))
+        {
+            state->reg[dest].kind = V_CONST; // Treat bytes inside the image as read-only data
+            state->reg[dest].value = flow->memory[h->value << 8 | l->value];
+        }
+        else if(h->kind == V_INDEX && l->kind == V_INDEX)
+        {
+            state->reg[dest].kind = l->value % 2 ? V_TABLE_HI : V_TABLE_LO;
+            state->reg[dest].value = h->value;
+        }
+        else
+        {
+            state->reg[dest].kind = V_UNKNOWN;
+        }
+        return;
+    }
+    if((opcode & 0xc7) == 0x06) // MVI
+    {
+        if(dest != 6)
+        {
+            state->reg[dest].kind = V_CONST;
+            state->reg[dest].value = inst[1];
+        }
+        return;
+    }
+    if((opcode & 0xc6) == 0x04) // INR and DCR
+    {
+        if(dest != 6)
+        {
+            if(state->reg[dest].kind == V_CONST)
+            {
+                state->reg[dest].value = (state->reg[dest].value + (opcode & 1 ? 0xff : 1)) & 0xff;
+            }
+            else
+            {
+                state->reg[dest].kind = V_UNKNOWN;
+            }
+        }
+        return;
+    }
+    if(opcode == 0x31 || opcode == 0x33 || opcode == 0x3b) // LXI, INX and DCX SP lose track of the stack
+    {
+        state->depth = 0;
+        return;
+    }
+    if(opcode == 0x39) // DAD SP
+    {
+        h->kind = V_UNKNOWN;
+        l->kind = V_UNKNOWN;
+        return;
+    }
+    if((opcode & 0xcf) == 0x01) // LXI
+    {
+        high->kind = V_CONST;
+        high->value = inst[2];
+        low->kind = V_CONST;
+        low->value = inst[1];
+        return;
+    }
+    if((opcode & 0xc7) == 0x03) // INX and DCX
+    {
+        sum = opcode & 0x08 ? -1 : 1;
+        if(high->kind == V_CONST && low->kind == V_CONST)
+        {
+            sum = (high->value << 8 | low->value) + sum;
+            high->value = (sum >> 8) & 0xff;
+            low->value = sum & 0xff;
+        }
+        else if(high->kind == V_INDEX && low->kind == V_INDEX)
+        {
+            low->value = (low->value + sum) & 0xffff;
+        }
+        else
+        {
+            high->kind = V_UNKNOWN;
+            low->kind = V_UNKNOWN;
+        }
+        return;
+    }
+    if((opcode & 0xcf) == 0x09) // DAD
+    {
+        if(h->kind == V_CONST && l->kind == V_CONST && high->kind == V_CONST && low->kind == V_CONST)
+        {
+            sum = (h->value << 8 | l->value) + (high->value << 8 | low->value);
+            h->value = (sum >> 8) & 0xff;
+            l->value = sum & 0xff;
+        }
+        else if(h->kind == V_CONST && l->kind == V_CONST && high != h) // Table address plus unknown index
+        {
+            h->value = h->value << 8 | l->value;
+            l->value = 0;
+            h->kind = V_INDEX;
+            l->kind = V_INDEX;
+        }
+        else if(high->kind == V_CONST && low->kind == V_CONST) // Unknown index plus table address
+        {
+            if(h->kind == V_INDEX && l->kind == V_INDEX)
+            {
+                l->value = (l->value + (high->value << 8 | low->value)) & 0xffff;
+            }
+            else
+            {
+                h->value = high->value << 8 | low->value;
+                l->value = 0;
+            }
+            h->kind = V_INDEX;
+            l->kind = V_INDEX;
+        }
+        else if(!(h->kind == V_INDEX && l->kind == V_INDEX && high != h)) // Adding an unknown index keeps the table address
+        {
+            h->kind = V_UNKNOWN;
+            l->kind = V_UNKNOWN;
+        }
+        return;
+    }
+    switch(opcode)
+    {
+    case 0x2a: // LHLD adr
+        h->kind = INSIDE(flow, address) && INSIDE(flow, address + 1) ? V_CONST : V_UNKNOWN;
+        h->value = flow->memory[address + 1];
+        l->kind = h->kind;
+        l->value = flow->memory[address];
+        break;
+    case 0x3a: // LDA adr
+        state->reg[7].kind = INSIDE(flow, address) ? V_CONST : V_UNKNOWN;
+        state->reg[7].value = flow->memory[address];
+        break;
+    case 0xeb: // XCHG
+        memcpy(swap, &state->reg[2], sizeof(swap));
+        memcpy(&state->reg[2], &state->reg[4], sizeof(swap));
+        memcpy(&state->reg[4], swap, sizeof(swap));
+        break;
+    case 0xe3: // XTHL
+        if(state->depth > 0)
+        {
+            memcpy(swap, state->stack[0], sizeof(swap));
+            memcpy(state->stack[0], &state->reg[4], sizeof(swap));
+            memcpy(&state->reg[4], swap, sizeof(swap));
+        }
+        else
+        {
+            h->kind = V_UNKNOWN;
+            l->kind = V_UNKNOWN;
+        }
+        break;
+    case 0xf9: // SPHL
+        state->depth = 0;
+        break;
+    case 0xc5: case 0xd5: case 0xe5: case 0xf5: // PUSH
+        if(state->depth == STACK_DEPTH)
+        {
+            state->depth--;
+        }
+        memmove(state->stack[1], state->stack[0], state->depth * sizeof(state->stack[0]));
+        state->stack[0][0] = opcode == 0xf5 ? state->reg[7] : *high;
+        state->stack[0][1] = *low;
+        if(opcode == 0xf5)
+        {
+            state->stack[0][1].kind = V_UNKNOWN; // Flags
+        }
+        state->depth++;
+        break;
+    case 0xc1: case 0xd1: case 0xe1: case 0xf1: // POP
+        if(opcode == 0xf1)
+        {
+            high = &state->reg[7];
+            low = &swap[0];
+        }
+        if(state->depth > 0)
+        {
+            *high = state->stack[0][0];
+            *low = state->stack[0][1];
+            state->depth--;
+            memmove(state->stack[0], state->stack[1], state->depth * sizeof(state->stack[0]));
+        }
+        else
+        {
+            high->kind = V_UNKNOWN;
+            low->kind = V_UNKNOWN;
+        }
+        break;
+    case 0x07: case 0x0f: case 0x17: case 0x1f: case 0x27: case 0x2f: // Rotates, DAA and CMA
+    case 0x0a: case 0x1a: case 0xdb: // LDAX and IN
+    case 0xc6: case 0xce: case 0xd6: case 0xde: case 0xe6: case 0xee: case 0xf6: // Immediate arithmetic and logic
+        state->reg[7].kind = V_UNKNOWN;
+        break;
+    default:
+        if(opcode >= 0x80 && opcode < 0xb8) // Arithmetic and logic on A, CMP leaves A alone
+        {
+            state->reg[7].kind = V_UNKNOWN;
+        }
+    }
+}
+/*
+jumpTargets resolves the destinations of the PCHL or RET at location from its entry state
+A constant address in HL, or on top of the stack for RET, is the only destination
+When PCHL follows loading HL from a table at a constant address, table is set to that address and every entry is a destination
+Entries are read until one points outside the image or to 0000 or ffff, or the table runs into code or into one of its own destinations
+jumpTargets returns the number of destinations, or 0 if they are unknown or RET simply returns
+*/
+int jumpTargets(Flow *flow, int location, RegState *state, uint16_t *targets, int *table)
+{
+    Value *h = &state->reg[4];
+    Value *l = &state->reg[5];
+    int count = 0;
+    int entry;
+    int target;
+    int i;
+
+    *table = -1;
+    if(flow->memory[location] != 0xe9) // RET and Rcc
+    {
+        if(state->depth > 0 && state->stack[0][0].kind == V_CONST && state->stack[0][1].kind == V_CONST)
+        {
+            targets[0] = state->stack[0][0].value << 8 | state->stack[0][1].value;
+            return(1);
+        }
+        return(0);
+    }
+    if(h->kind == V_CONST && l->kind == V_CONST)
+    {
+        targets[0] = h->value << 8 | l->value;
+        return(1);
+    }
+    if(h->kind != V_TABLE_HI || l->kind != V_TABLE_LO || h->value != l->value)
+    {
+        return(0);
+    }
+    *table = h->value;
+    for(entry = h->value; count < TABLE_LIMIT && INSIDE(flow, entry) && INSIDE(flow, entry + 1); entry += 2)
+    {
+        target = flow->memory[entry] | flow->memory[entry + 1] << 8;
+        if(BIT_TEST(flow->code, entry) || !INSIDE(flow, target) || target == 0x0000 || target == 0xffff) // Blank and erased bytes end a table
+        {
+            break;
+        }
+        for(i = 0; i < count && targets[i] != entry; i++);
+        if(i < count)
+        {
+            break;
+        }
+        targets[count++] = target;
+    }
+    return(count);
+}
+// printJumps prints the resolved destinations of the indirect jumps reached by flow, and those left unresolved
+void printJumps(FILE *out, Flow *flow)
+{
+    uint16_t targets[TABLE_LIMIT];
+    int count;
+    int table;
+    int reached = 0;
+    int location;
+    int i;
+
+    for(location = flow->start; location < flow->end; location++)
+    {
+        if(!BIT_TEST(flow->code, location))
+        {
+            continue;
+        }
+        reached++;
+        if(flow->memory[location] != 0xe9 && flow->memory[location] != 0xc9 && (flow->memory[location] & 0xc7) != 0xc0)
+        {
+            continue;
+        }
+        count = jumpTargets(flow, location, &flow->state[location], targets, &table);
+        if(count == 0 && flow->memory[location] != 0xe9)
+        {
+            continue; // An ordinary return
+        }
+        fprintf(out,"; %04x %-4s ", location, flow->memory[location] == 0xe9 ? "PCHL" : "RET");
+        if(count == 0)
+        {
+            fprintf(out,"target unknown\n");
+            continue;
+        }
+        if(table >= 0)
+        {
+            fprintf(out,"jumps through table at %04x to", table);
+        }
+        else
+        {
+            fprintf(out,"jumps to");
+        }
+        for(i = 0; i < count; i++)
+        {
+            fprintf(out," %04x", targets[i]);
+        }
+        fputc('\n', out);
+    }
+    fprintf(out,"; %d instructions reached from the entry points\n", reached);
+}
+
+// readBankMap reads the bank map at path, exiting if it cannot be read or an entry is malformed
+// Ranges are checked against their limits by subtraction, since sums of the values read could wrap
+BankMap *readBankMap(char *path)
+{
+    FILE *input;
+    BankMap *map;
+    char line[256];
+    char kind[16];
+    unsigned int id;
+    unsigned long long offset;
+    unsigned int length;
+    unsigned int address;
+    int fields;
+    int lineNumber = 0;
+    void *grown;
+
+    input = fopen(path,"r");
+    if(input == NULL)
+    {
+        fprintf(stderr,"%s: %s\n",path,strerror(errno));
+        exit(2);
+    }
+    map = (BankMap *)calloc(1, sizeof(BankMap));
+    if(map == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    pthread_mutex_init(&map->lock, NULL);
+    while(fgets(line, sizeof(line), input) != NULL)
+    {
+        lineNumber++;
+        if(strchr(line, '#') != NULL)
+        {
+            *strchr(line, '#') = '\0';
+        }
+        fields = sscanf(line, "%15s", kind);
+        if(fields < 1)
+        {
+            continue;
+        }
+        if(strcmp(kind,"bank") == 0 && sscanf(line, "%*s %x %llx %x %x", &id, &offset, &length, &address) == 4 && id <= INT_MAX && address <= 0xffff && length > 0 && length <= 0x10000 - address && offset <= (unsigned long long)INT64_MAX - length)
+        {
+            grown = realloc(map->banks, (map->bankCount + 1) * sizeof(Bank));
+            if(grown == NULL)
+            {
+                fprintf(stderr,"Out of memory!\n");
+                exit(99);
+            }
+            map->banks = (Bank *)grown;
+            memset(&map->banks[map->bankCount], 0, sizeof(Bank));
+            map->banks[map->bankCount].id = id;
+            map->banks[map->bankCount].offset = offset;
+            map->banks[map->bankCount].length = length;
+            map->banks[map->bankCount].address = address;
+            map->bankCount++;
+        }
+        else if(strcmp(kind,"trampoline") == 0 && sscanf(line, "%*s %x %x", &address, &id) == 2 && address <= 0xffff && id <= INT_MAX)
+        {
+            grown = realloc(map->trampolines, (map->trampolineCount + 1) * sizeof(Trampoline));
+            if(grown == NULL)
+            {
+                fprintf(stderr,"Out of memory!\n");
+                exit(99);
+            }
+            map->trampolines = (Trampoline *)grown;
+            map->trampolines[map->trampolineCount].address = address;
+            map->trampolines[map->trampolineCount].bank = id;
+            map->trampolineCount++;
+        }
+        else
+        {
+            // invalid argument
+            fprintf(stderr,"%s:%d: %s\n",path,lineNumber,strerror(22));
+            exit(22);
+        }
+    }
+    fclose(input);
+    return(map);
+}
+// decodeBanks disassembles every bank of map from the file at path on a pool of threads, then prints the listings in map order
+void decodeBanks(BankMap *map, char *path)
+{
+    struct stat info;
+    pthread_t *workers;
+    long workerCount;
+    int i;
+
+    map->input = open(path, O_RDONLY);
+    if(map->input < 0 || fstat(map->input, &info) != 0)
+    {
+        fprintf(stderr,"%s\n",strerror(2));
+        exit(2);
+    }
+    if(!S_ISREG(info.st_mode)) // Banks are read in parallel from their own locations, so the file must be seekable and uncompressed
+    {
+        // illegal seek
+        fprintf(stderr,"%s\n",strerror(29));
+        exit(29);
+    }
+    workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if(workerCount < 1)
+    {
+        workerCount = 1;
+    }
+    if(workerCount > map->bankCount)
+    {
+        workerCount = map->bankCount;
+    }
+    workers = (pthread_t *)malloc(workerCount * sizeof(pthread_t));
+    if(workers == NULL && workerCount > 0)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    for(i = 0; i < workerCount; i++)
+    {
+        if(pthread_create(&workers[i], NULL, decodeBank, map) != 0)
+        {
+            fprintf(stderr,"%s\n",strerror(errno));
+            exit(errno);
+        }
+    }
+    for(i = 0; i < workerCount; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    close(map->input);
+
+    for(i = 0; i < map->bankCount; i++)
+    {
+        if(map->banks[i].error != 0)
+        {
+            fprintf(stderr,"bank %x: %s\n",map->banks[i].id,strerror(map->banks[i].error));
+            exit(map->banks[i].error);
+        }
+    }
+    for(i = 0; i < map->bankCount; i++)
+    {
+        printf("; bank %x: %08" PRIx64 "-%08" PRIx64 " at %04x-%04x\n", map->banks[i].id, map->banks[i].offset, map->banks[i].offset + map->banks[i].length - 1, map->banks[i].address, map->banks[i].address + map->banks[i].length - 1);
+        fwrite(map->banks[i].text, 1, map->banks[i].textSize, stdout);
+        free(map->banks[i].text);
+    }
+}
+// decodeBank is the body of a worker thread, taking banks from map in turn and listing each into its own text buffer
+void *decodeBank(void *arg)
+{
+    BankMap *map = (BankMap *)arg;
+    Bank *bank;
+    Listing list;
+    uint8_t *buffer;
+    ssize_t got;
+    int filled;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&map->lock);
+        bank = map->nextBank < map->bankCount ? &map->banks[map->nextBank++] : NULL;
+        pthread_mutex_unlock(&map->lock);
+        if(bank == NULL)
+        {
+            return(NULL);
+        }
+        buffer = (uint8_t *)calloc(bank->length + 2, sizeof(uint8_t));
+        if(buffer == NULL)
+        {
+            bank->error = ENOMEM;
+            continue;
+        }
+        for(filled = 0; filled < bank->length; filled += got)
+        {
+            got = pread(map->input, buffer + filled, bank->length - filled, bank->offset + filled);
+            if(got <= 0)
+            {
+                bank->error = got == 0 ? ENXIO : errno; // A bank beyond the end of the file is reported as no such address
+                break;
+            }
+        }
+        list.out = open_memstream(&bank->text, &bank->textSize);
+        list.origin = bank->address - bank->offset;
+        list.map = map;
+        list.access = NULL;
+        if(bank->error == 0 && list.out == NULL)
+        {
+            bank->error = errno;
+        }
+        if(bank->error == 0)
+        {
+            readBuffer(&list, buffer, bank->offset, bank->length, 1);
+        }
+        if(list.out != NULL)
+        {
+            fclose(list.out);
+        }
+        free(buffer);
+    }
+}
+
+/*
+countCorpus decodes every file of paths on a pool of threads, each counting into its own Stats, and prints the merged counts
+Counts are opcode frequencies, frequencies of consecutive pairs and triples of opcodes, and instruction lengths
+Workers share nothing but the index of the next file, and their counts are only merged after all have finished
+*/
+void countCorpus(char **paths, int pathCount, int json)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    int nextPath = 0;
+    Stats *stats;
+    pthread_t *workers;
+    long workerCount;
+    uint64_t *triples;
+    char *separator;
+    int i;
+    int j;
+
+    workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if(workerCount < 1)
+    {
+        workerCount = 1;
+    }
+    if(workerCount > pathCount)
+    {
+        workerCount = pathCount;
+    }
+    stats = (Stats *)calloc(workerCount, sizeof(Stats));
+    workers = (pthread_t *)malloc(workerCount * sizeof(pthread_t));
+    triples = (uint64_t *)calloc(1 << 24, sizeof(uint64_t));
+    if(stats == NULL || workers == NULL || triples == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    for(i = 0; i < workerCount; i++)
+    {
+        stats[i].triples = (uint32_t *)calloc(1 << 24, sizeof(uint32_t));
+        if(stats[i].triples == NULL)
+        {
+            fprintf(stderr,"Out of memory!\n");
+            exit(99);
+        }
+        stats[i].tripleTotals = triples;
+        stats[i].paths = paths;
+        stats[i].pathCount = pathCount;
+        stats[i].nextPath = &nextPath;
+        stats[i].lock = &lock;
+        if(pthread_create(&workers[i], NULL, countFiles, &stats[i]) != 0)
+        {
+            fprintf(stderr,"%s\n",strerror(errno));
+            exit(errno);
+        }
+    }
+    for(i = 0; i < workerCount; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    // Merge into the first worker's counts, except for triples, whose totals need 64 bits
+    for(i = 0; i < workerCount; i++)
+    {
+        for(j = 0; j < 1 << 24; j++)
+        {
+            if(stats[i].triples[j] != 0)
+            {
+                triples[j] += stats[i].triples[j];
+            }
+        }
+        free(stats[i].triples);
+    }
+    for(i = 1; i < workerCount; i++)
+    {
+        stats[0].files += stats[i].files;
+        stats[0].failed += stats[i].failed;
+        stats[0].bytes += stats[i].bytes;
+        for(j = 0; j < 4; j++)
+        {
+            stats[0].lengths[j] += stats[i].lengths[j];
+        }
+        for(j = 0; j < 256; j++)
+        {
+            stats[0].opcodes[j] += stats[i].opcodes[j];
+        }
+        for(j = 0; j < 65536; j++)
+        {
+            stats[0].pairs[j] += stats[i].pairs[j];
+        }
+    }
+
+    if(json)
+    {
+        printf("{\"files\": %" PRIu64 ", \"failed\": %" PRIu64 ", \"bytes\": %" PRIu64 ",\n", stats[0].files, stats[0].failed, stats[0].bytes);
+        printf("\"lengths\": {\"1\": %" PRIu64 ", \"2\": %" PRIu64 ", \"3\": %" PRIu64 "},\n\"opcodes\": {", stats[0].lengths[1], stats[0].lengths[2], stats[0].lengths[3]);
+        separator = "";
+        for(i = 0; i < 256; i++)
+        {
+            if(stats[0].opcodes[i] != 0)
+            {
+                printf("%s\"%02x\": %" PRIu64, separator, i, stats[0].opcodes[i]);
+                separator = ", ";
+            }
+        }
+        printf("},\n\"pairs\": {");
+        separator = "";
+        for(i = 0; i < 65536; i++)
+        {
+            if(stats[0].pairs[i] != 0)
+            {
+                printf("%s\"%02x %02x\": %" PRIu64, separator, i >> 8, i & 0xff, stats[0].pairs[i]);
+                separator = ", ";
+            }
+        }
+        printf("},\n\"triples\": {");
+        separator = "";
+    }
+    else
+    {
+        printf("kind,key,count\n");
+        printf("files,,%" PRIu64 "\nfailed,,%" PRIu64 "\nbytes,,%" PRIu64 "\n", stats[0].files, stats[0].failed, stats[0].bytes);
+        for(i = 1; i < 4; i++)
+        {
+            printf("length,%d,%" PRIu64 "\n", i, stats[0].lengths[i]);
+        }
+        for(i = 0; i < 256; i++)
+        {
+            if(stats[0].opcodes[i] != 0)
+            {
+                printf("opcode,%02x,%" PRIu64 "\n", i, stats[0].opcodes[i]);
+            }
+        }
+        for(i = 0; i < 65536; i++)
+        {
+            if(stats[0].pairs[i] != 0)
+            {
+                printf("pair,%02x %02x,%" PRIu64 "\n", i >> 8, i & 0xff, stats[0].pairs[i]);
+            }
+        }
+        separator = NULL;
+    }
+    for(i = 0; i < 1 << 24; i++)
+    {
+        if(triples[i] == 0)
+        {
+            continue;
+        }
+        if(json)
+        {
+            printf("%s\"%02x %02x %02x\": %" PRIu64, separator, i >> 16, (i >> 8) & 0xff, i & 0xff, triples[i]);
+            separator = ", ";
+        }
+        else
+        {
+            printf("triple,%02x %02x %02x,%" PRIu64 "\n", i >> 16, (i >> 8) & 0xff, i & 0xff, triples[i]);
+        }
+    }
+    if(json)
+    {
+        printf("}}\n");
+    }
+    free(triples);
+    free(stats);
+    free(workers);
+}
+// countFiles is the body of a worker thread, taking files from the corpus in turn and counting their instructions into the Stats passed as arg
+void *countFiles(void *arg)
+{
+    Stats *stats = (Stats *)arg;
+    FILE *input;
+    pid_t decompressor;
+    int path;
+    int failed;
+
+    for(;;)
+    {
+        pthread_mutex_lock(stats->lock);
+        path = *stats->nextPath < stats->pathCount ? (*stats->nextPath)++ : -1;
+        pthread_mutex_unlock(stats->lock);
+        if(path < 0)
+        {
+            return(NULL);
+        }
+        input = openInput(stats->paths[path], &decompressor);
+        if(input == NULL)
+        {
+            fprintf(stderr,"%s: %s\n",stats->paths[path],strerror(errno));
+            stats->failed++;
+            continue;
+        }
+        failed = countStream(stats, input) != 0;
+        if(closeInput(input, decompressor) != 0 || failed)
+        {
+            fprintf(stderr,"%s: %s\n",stats->paths[path],strerror(5));
+            stats->failed++;
+            continue;
+        }
+        stats->files++;
+    }
+}
+// countStream makes the same linear sweep over input as decodeStream, counting instructions instead of printing them
+// countStream returns 0, or -1 if input could not be read
+int countStream(Stats *stats, FILE *input)
+{
+    uint8_t buffer[CHUNK_SIZE];
+    uint32_t history = 0; // The last three opcodes, most recent in the low byte
+    int seen = 0; // Number of opcodes in history
+    int operands = 0; // Operand bytes still to skip, which may continue into the next chunk
+    size_t filled;
+    size_t i;
+
+    while((filled = fread(buffer,sizeof(uint8_t),CHUNK_SIZE,input)) > 0)
+    {
+        stats->bytes += filled;
+        for(i = 0; i < filled; i++)
+        {
+            if(operands > 0)
+            {
+                operands--;
+                continue;
+            }
+            operands = instLength(buffer[i]) - 1;
+            stats->lengths[operands + 1]++;
+            stats->opcodes[buffer[i]]++;
+            history = (history << 8 | buffer[i]) & 0xffffff;
+            if(++seen >= 2)
+            {
+                stats->pairs[history & 0xffff]++;
+            }
+            if(seen >= 3 && ++stats->triples[history] == 0)
+            {
+                pthread_mutex_lock(stats->lock);
+                stats->tripleTotals[history] += (uint64_t)1 << 32;
+                pthread_mutex_unlock(stats->lock);
+            }
+        }
+    }
+    return(ferror(input) ? -1 : 0);
+}
+
+// buildIndex makes the linear sweep over input, recording a checkpoint every CHECKPOINT_INTERVAL bytes
+// buildIndex returns the checkpoints and sets count to their number
+Checkpoint *buildIndex(FILE *input, uint64_t *count)
+{
+    uint8_t buffer[CHUNK_SIZE];
+    Checkpoint *index = NULL;
+    Checkpoint *grown;
+    uint64_t capacity = 0;
+    uint64_t location = 0; // Location of buffer[0] in the file
+    uint64_t line = 0;
+    uint64_t next = 0; // Location of the next instruction
+    size_t filled;
+    size_t i;
+
+    *count = 0;
+    while((filled = fread(buffer,sizeof(uint8_t),CHUNK_SIZE,input)) > 0)
+    {
+        for(i = next - location; i < filled; i += instLength(buffer[i]))
+        {
+            if(location + i >= *count * CHECKPOINT_INTERVAL)
+            {
+                if(*count == capacity)
+                {
+                    capacity = capacity == 0 ? 1024 : capacity * 2;
+                    grown = (Checkpoint *)realloc(index, capacity * sizeof(Checkpoint));
+                    if(grown == NULL)
+                    {
+                        fprintf(stderr,"Out of memory!\n");
+                        exit(99);
+                    }
+                    index = grown;
+                }
+                index[*count].offset = location + i;
+                index[*count].line = line;
+                (*count)++;
+            }
+            line++;
+        }
+        next = location + i;
+        location += filled;
+    }
+    if(ferror(input))
+    {
+        fprintf(stderr,"%s\n",strerror(5));
+        exit(5);
+    }
+    return(index);
+}
+// readIndex reads the index file at path if it was built from an input of the size and modification time in source
+// readIndex returns the checkpoints and sets count to their number, or returns NULL if there is no such index
+Checkpoint *readIndex(char *path, struct stat *source, uint64_t *count)
+{
+    FILE *input;
+    IndexHeader header;
+    struct stat info;
+    Checkpoint *index = NULL;
+
+    input = fopen(path,"rbe");
+    if(input == NULL)
+    {
+        return(NULL);
+    }
+    // A count that does not match the length of the file means the index is damaged, so it is rebuilt rather than trusted
+    if(fstat(fileno(input), &info) == 0 && (uint64_t)info.st_size >= sizeof(header) && fread(&header,sizeof(header),1,input) == 1
+       && memcmp(header.magic,"8080",4) == 0 && header.interval == CHECKPOINT_INTERVAL && header.size == (uint64_t)source->st_size
+       && header.modified == (int64_t)source->st_mtime && ((uint64_t)info.st_size - sizeof(header)) % sizeof(Checkpoint) == 0
+       && header.count == ((uint64_t)info.st_size - sizeof(header)) / sizeof(Checkpoint) && header.count < SIZE_MAX / sizeof(Checkpoint))
+    {
+        index = (Checkpoint *)malloc(header.count * sizeof(Checkpoint) + 1);
+        if(index == NULL)
+        {
+            fprintf(stderr,"Out of memory!\n");
+            exit(99);
+        }
+        if(fread(index,sizeof(Checkpoint),header.count,input) != header.count)
+        {
+            free(index);
+            index = NULL;
+        }
+        else
+        {
+            *count = header.count;
+        }
+    }
+    fclose(input);
+    return(index);
+}
+// writeIndex writes count checkpoints of index, built from the input described by source, to the index file at path
+// The file holds the checkpoints in the byte order of this machine, so it is a cache for this machine and not an exchange format
+void writeIndex(char *path, struct stat *source, Checkpoint *index, uint64_t count)
+{
+    FILE *output;
+    IndexHeader header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "8080", 4);
+    header.interval = CHECKPOINT_INTERVAL;
+    header.size = source->st_size;
+    header.modified = source->st_mtime;
+    header.count = count;
+    output = fopen(path,"wb");
+    if(output == NULL || fwrite(&header,sizeof(header),1,output) != 1 || fwrite(index,sizeof(Checkpoint),count,output) != count || fclose(output) != 0)
+    {
+        fprintf(stderr,"%s: %s\n",path,strerror(errno));
+        exit(errno);
+    }
+}
+/*
+printAt lists lines instructions of input, starting with the instruction on line target if byLine is set or else the one containing location target
+Decoding starts from the last checkpoint before target, so only the bytes from there on are read and decoded
+Input that cannot seek, such as a compressed file, is read up to the checkpoint instead
+printAt returns 0, or -1 without printing anything if target is past the last line or the end of input
+*/
+int printAt(Listing *list, FILE *input, Checkpoint *index, uint64_t count, int byLine, uint64_t target, uint64_t lines)
+{
+    uint8_t *buffer;
+    uint8_t skipped[CHUNK_SIZE];
+    uint64_t low = 0;
+    uint64_t high = count;
+    uint64_t middle;
+    uint64_t location;
+    uint64_t line;
+    size_t capacity;
+    size_t filled;
+    size_t start;
+    size_t end;
+    size_t got;
+
+    if(count == 0)
+    {
+        return(-1);
+    }
+    while(high - low > 1) // Find the last checkpoint at or before target
+    {
+        middle = low + (high - low) / 2;
+        if((byLine ? index[middle].line : index[middle].offset) <= target)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    location = index[low].offset;
+    line = index[low].line;
+    if(fseeko(input, location, SEEK_SET) != 0)
+    {
+        for(got = 0; got < location; got += filled)
+        {
+            filled = fread(skipped,sizeof(uint8_t),location - got < CHUNK_SIZE ? location - got : CHUNK_SIZE,input);
+            if(filled == 0)
+            {
+                return(-1);
+            }
+        }
+    }
+    if(lines > (SIZE_MAX - CHECKPOINT_INTERVAL - 8) / 3)
+    {
+        lines = (SIZE_MAX - CHECKPOINT_INTERVAL - 8) / 3;
+    }
+    capacity = CHECKPOINT_INTERVAL + 3 * lines + 3; // From the checkpoint to the end of the last instruction wanted
+    buffer = (uint8_t *)malloc(capacity + 2);
+    if(buffer == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    filled = fread(buffer,sizeof(uint8_t),capacity,input);
+    memset(buffer + filled, 0, 2);
+    // Walk to the first instruction wanted, then past the last
+    for(start = 0; start < filled; start += instLength(buffer[start]), line++)
+    {
+        if(byLine ? line == target : location + start + instLength(buffer[start]) > target)
+        {
+            break;
+        }
+    }
+    if(start >= filled || (!byLine && target >= location + filled)) // An instruction truncated by the end of input only contains locations before it
+    {
+        free(buffer);
+        return(-1);
+    }
+    for(end = start; end < filled && lines > 0; end += instLength(buffer[end]), lines--);
+    if(end > start)
+    {
+        readBuffer(list, buffer + start, location + start, (end > filled ? filled : end) - start, 1);
+    }
+    free(buffer);
+    return(0);
+}
+
+// flowSuccessors stores in targets the addresses control can pass to from the instruction at location, other than into a routine it calls
+// callee is set to the address called by CALL, Ccc or RST, or to -1
+// flowSuccessors returns the number of targets stored, or -1 if the instruction is a PCHL whose targets are unknown
+int flowSuccessors(Flow *flow, int location, uint16_t *targets, int *callee)
+{
+    uint8_t *inst = flow->memory + location;
+    uint8_t opcode = *inst;
+    int table;
+    int count = 0;
+
+    *callee = -1;
+    if(opcode == 0xcd || (opcode & 0xc7) == 0xc4) // CALL and Ccc
+    {
+        *callee = inst[1] | inst[2] << 8;
+    }
+    else if((opcode & 0xc7) == 0xc7) // RST
+    {
+        *callee = opcode & 0x38;
+    }
+    else if(opcode == 0xc3 || (opcode & 0xc7) == 0xc2) // JMP and Jcc
+    {
+        targets[count++] = inst[1] | inst[2] << 8;
+        if(opcode == 0xc3)
+        {
+            return(count);
+        }
+    }
+    else if(opcode == 0xc9 || (opcode & 0xc7) == 0xc0) // RET and Rcc, which only continue elsewhere after a constant was pushed
+    {
+        count = jumpTargets(flow, location, &flow->state[location], targets, &table);
+        if(opcode == 0xc9)
+        {
+            return(count);
+        }
+    }
+    else if(opcode == 0xe9) // PCHL
+    {
+        count = jumpTargets(flow, location, &flow->state[location], targets, &table);
+        return(count > 0 ? count : -1);
+    }
+    targets[count++] = location + instLength(opcode);
+    return(count);
+}
+/*
+analyseStack builds the call graph of the code reached by flow and bounds the stack used by each routine
+A routine is an entry point of flow, an address called by CALL, Ccc or RST, or code shared by routines as found by shareRoutines
+Every instruction then belongs to one routine and is walked once, tracking the bytes pushed since its entry, so the work grows with the size of the image
+*/
+StackReport *analyseStack(Flow *flow)
+{
+    StackReport *report;
+    int16_t *depthAt;
+    uint16_t *work;
+    uint16_t targets[TABLE_LIMIT + 1];
+    int callee;
+    int location;
+    int i;
+
+    report = (StackReport *)calloc(1, sizeof(StackReport));
+    depthAt = (int16_t *)malloc(65536 * sizeof(int16_t));
+    work = (uint16_t *)malloc(65536 * sizeof(uint16_t));
+    if(report == NULL || depthAt == NULL || work == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    // Mark the entry points and every address called, then number them in address order
+    for(location = 0; location < 65536; location++)
+    {
+        report->routineOf[location] = -1;
+    }
+    for(location = 0; location < 0x40; location += 8)
+    {
+        if(INSIDE(flow, flow->start == 0 ? location : flow->start))
+        {
+            report->routineOf[flow->start == 0 ? location : flow->start] = 0;
+        }
+    }
+    for(location = flow->start; location < flow->end; location++)
+    {
+        if(BIT_TEST(flow->code, location))
+        {
+            flowSuccessors(flow, location, targets, &callee);
+            if(callee >= 0 && BIT_TEST(flow->code, callee))
+            {
+                report->routineOf[callee] = 0;
+            }
+        }
+    }
+    shareRoutines(flow, report);
+    report->routines = (Routine *)calloc(65536, sizeof(Routine));
+    if(report->routines == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    for(location = 0; location < 65536; location++)
+    {
+        if(report->routineOf[location] >= 0 && BIT_TEST(flow->code, location))
+        {
+            report->routines[report->routineCount].shared = report->routineOf[location] == 1;
+            report->routineOf[location] = report->routineCount;
+            report->routines[report->routineCount].address = location;
+            report->routines[report->routineCount].worst = -1;
+            report->routineCount++;
+        }
+        else
+        {
+            report->routineOf[location] = -1;
+        }
+    }
+    for(location = 0; location < 65536; location++)
+    {
+        depthAt[location] = STACK_UNREACHED;
+    }
+    for(i = 0; i < report->routineCount; i++)
+    {
+        walkRoutine(flow, report, i, depthAt, work);
+    }
+    for(i = 0; i < report->routineCount; i++)
+    {
+        worstStack(report, i);
+    }
+    free(depthAt);
+    free(work);
+    return(report);
+}
+/*
+shareRoutines marks in routineOf, with 1, the code that the entries marked with 0 reach other than all through one of them, making it a routine too
+Such code is where the routines reaching it meet: an address whose immediate dominator, below a root calling every entry, is the root itself
+Dominators are found by the iterative algorithm of Cooper, Harvey and Kennedy over the addresses in postorder, which settles in a few passes
+*/
+void shareRoutines(Flow *flow, StackReport *report)
+{
+    uint16_t targets[TABLE_LIMIT + 1];
+    int *edges = NULL; // Successors of each address and then the root, the root being numbered 65536
+    int edgeCount = 0;
+    int edgeCapacity = 0;
+    int *edgeStart;
+    int *number; // Postorder number of each address reached, the root numbered last, or -1
+    int *node; // Address of each postorder number
+    int *stack;
+    int *next; // Next edge to follow from each node on stack
+    int *predStart;
+    int *preds; // Predecessors by number
+    int *idom; // Immediate dominator by number, or -1 until found
+    int nodes = 0;
+    int location;
+    int callee;
+    int count;
+    int top;
+    int changed;
+    int dominator;
+    int a;
+    int b;
+    int i;
+
+    edgeStart = (int *)malloc(65538 * sizeof(int));
+    number = (int *)malloc(65537 * sizeof(int));
+    node = (int *)malloc(65537 * sizeof(int));
+    stack = (int *)malloc(65537 * sizeof(int));
+    next = (int *)malloc(65537 * sizeof(int));
+    predStart = (int *)calloc(65538, sizeof(int));
+    idom = (int *)malloc(65537 * sizeof(int));
+    if(edgeStart == NULL || number == NULL || node == NULL || stack == NULL || next == NULL || predStart == NULL || idom == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    for(location = 0; location < 65536; location++)
+    {
+        edgeStart[location] = edgeCount;
+        if(INSIDE(flow, location) && BIT_TEST(flow->code, location))
+        {
+            edges = growEdges(edges, &edgeCapacity, edgeCount + TABLE_LIMIT + 1);
+            count = flowSuccessors(flow, location, targets, &callee);
+            for(i = 0; i < count; i++)
+            {
+                if(INSIDE(flow, targets[i]) && BIT_TEST(flow->code, targets[i]))
+                {
+                    edges[edgeCount++] = targets[i];
+                }
+            }
+        }
+    }
+    edgeStart[65536] = edgeCount;
+    edges = growEdges(edges, &edgeCapacity, edgeCount + 65536);
+    for(location = 0; location < 65536; location++)
+    {
+        if(report->routineOf[location] == 0 && BIT_TEST(flow->code, location))
+        {
+            edges[edgeCount++] = location;
+        }
+    }
+    edgeStart[65537] = edgeCount;
+
+    // Number the nodes in postorder by a depth first search from the root
+    for(location = 0; location <= 65536; location++)
+    {
+        number[location] = -1;
+    }
+    top = 0;
+    stack[0] = 65536;
+    next[0] = edgeStart[65536];
+    number[65536] = -2; // On the stack
+    while(top >= 0)
+    {
+        location = stack[top];
+        if(next[top] < edgeStart[location + 1])
+        {
+            b = edges[next[top]++];
+            if(number[b] == -1)
+            {
+                number[b] = -2;
+                top++;
+                stack[top] = b;
+                next[top] = edgeStart[b];
+            }
+            continue;
+        }
+        number[location] = nodes;
+        node[nodes++] = location;
+        top--;
+    }
+
+    // Gather the predecessors of each node by number
+    for(location = 0; location <= 65536; location++)
+    {
+        for(i = edgeStart[location]; number[location] >= 0 && i < edgeStart[location + 1]; i++)
+        {
+            predStart[number[edges[i]] + 1]++;
+        }
+    }
+    for(i = 0; i < nodes; i++)
+    {
+        predStart[i + 1] += predStart[i];
+    }
+    preds = (int *)malloc((predStart[nodes] + 1) * sizeof(int));
+    if(preds == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    for(i = 0; i < nodes; i++)
+    {
+        next[i] = predStart[i];
+    }
+    for(location = 0; location <= 65536; location++)
+    {
+        for(i = edgeStart[location]; number[location] >= 0 && i < edgeStart[location + 1]; i++)
+        {
+            preds[next[number[edges[i]]]++] = number[location];
+        }
+    }
+
+    // Refine the dominators in reverse postorder until they stop changing, intersecting the dominators of the predecessors found so far
+    for(i = 0; i < nodes; i++)
+    {
+        idom[i] = -1;
+    }
+    idom[nodes - 1] = nodes - 1;
+    do
+    {
+        changed = 0;
+        for(b = nodes - 2; b >= 0; b--)
+        {
+            dominator = -1;
+            for(i = predStart[b]; i < predStart[b + 1]; i++)
+            {
+                a = preds[i];
+                if(idom[a] < 0)
+                {
+                    continue;
+                }
+                while(dominator >= 0 && a != dominator) // Walk up from both until they meet, the higher number being nearer the root
+                {
+                    while(a < dominator)
+                    {
+                        a = idom[a];
+                    }
+                    while(dominator < a)
+                    {
+                        dominator = idom[dominator];
+                    }
+                }
+                dominator = a;
+            }
+            if(idom[b] != dominator)
+            {
+                idom[b] = dominator;
+                changed = 1;
+            }
+        }
+    } while(changed);
+
+    for(b = 0; b < nodes - 1; b++)
+    {
+        if(idom[b] == nodes - 1 && report->routineOf[node[b]] != 0)
+        {
+            report->routineOf[node[b]] = 1;
+        }
+    }
+    free(edges);
+    free(edgeStart);
+    free(number);
+    free(node);
+    free(stack);
+    free(next);
+    free(predStart);
+    free(preds);
+    free(idom);
+}
+// growEdges returns edges with room for at least needed, doubling capacity as it grows
+int *growEdges(int *edges, int *capacity, int needed)
+{
+    if(needed <= *capacity)
+    {
+        return(edges);
+    }
+    *capacity = *capacity * 2 > needed ? *capacity * 2 : needed;
+    edges = (int *)realloc(edges, *capacity * sizeof(int));
+    if(edges == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    return(edges);
+}
+// walkRoutine follows the code of routine, recording its deepest stack use, the calls it makes and the flags that weaken the bound
+// depthAt must be STACK_UNREACHED for every address and is left that way, work is room for 65536 addresses
+void walkRoutine(Flow *flow, StackReport *report, int routine, int16_t *depthAt, uint16_t *work)
+{
+    Routine *r = &report->routines[routine];
+    uint16_t targets[TABLE_LIMIT + 1];
+    CallSite *grown;
+    int pending = 0; // Addresses in work still to visit
+    int reached = 0; // Addresses in work, all of which must be reset in depthAt
+    int location;
+    int depth;
+    int count;
+    int callee;
+    int tail;
+    int popped;
+    int i;
+    uint8_t opcode;
+
+    r->firstCall = report->callCount;
+    depthAt[r->address] = 0;
+    work[reached++] = r->address;
+    while(pending < reached)
+    {
+        location = work[pending++];
+        depth = depthAt[location];
+        opcode = flow->memory[location];
+        switch(opcode)
+        {
+        case 0xc5: case 0xd5: case 0xe5: case 0xf5: // PUSH
+            depth += 2;
+            break;
+        case 0xc1: case 0xd1: case 0xe1: case 0xf1: // POP
+            depth -= 2;
+            break;
+        case 0x31: // LXI SP starts a new stack, measured from there on
+            depth = 0;
+            break;
+        case 0x33: // INX SP
+            depth -= 1;
+            break;
+        case 0x3b: // DCX SP
+            depth += 1;
+            break;
+        case 0xf9: // SPHL
+            r->flags |= STACK_UNKNOWN;
+            continue;
+        }
+        if(depth <= STACK_UNREACHED + 2 || depth > INT16_MAX) // Beyond anything a real stack holds, and not storable in depthAt
+        {
+            r->flags |= STACK_UNKNOWN;
+            continue;
+        }
+        if(depth > r->local)
+        {
+            r->local = depth;
+        }
+        count = flowSuccessors(flow, location, targets, &callee);
+        if(count < 0)
+        {
+            r->flags |= STACK_UNKNOWN;
+            continue;
+        }
+        popped = 0;
+        if(opcode == 0xc9 || (opcode & 0xc7) == 0xc0) // RET and Rcc
+        {
+            popped = opcode == 0xc9 ? count : count - 1; // Targets before the fall through of Rcc are pushed constants
+            if(popped == 0 && depth != 0 && !r->shared) // Shared code is entered with whatever its callers pushed
+            {
+                r->flags |= STACK_UNBALANCED; // Returns with something other than the return address on top
+            }
+        }
+        for(i = 0; i < count + (callee >= 0); i++)
+        {
+            tail = i < count && report->routineOf[targets[i]] >= 0 && targets[i] != r->address;
+            if(i == count || tail) // Record calls, and jumps into other routines, as edges of the call graph
+            {
+                if(report->callCount == report->callCapacity)
+                {
+                    report->callCapacity = report->callCapacity == 0 ? 1024 : report->callCapacity * 2;
+                    grown = (CallSite *)realloc(report->calls, report->callCapacity * sizeof(CallSite));
+                    if(grown == NULL)
+                    {
+                        fprintf(stderr,"Out of memory!\n");
+                        exit(99);
+                    }
+                    report->calls = grown;
+                }
+                report->calls[report->callCount].callee = i == count ? callee : targets[i];
+                report->calls[report->callCount].depth = depth;
+                report->calls[report->callCount].tail = tail;
+                report->callCount++;
+                continue;
+            }
+            if(!INSIDE(flow, targets[i]) || !BIT_TEST(flow->code, targets[i]))
+            {
+                continue;
+            }
+            if(depthAt[targets[i]] == STACK_UNREACHED)
+            {
+                depthAt[targets[i]] = i < popped ? depth - 2 : depth;
+                work[reached++] = targets[i];
+            }
+            else if(depthAt[targets[i]] != (i < popped ? depth - 2 : depth))
+            {
+                r->flags |= STACK_UNBALANCED; // Reached again with a different depth, such as a loop that pushes
+            }
+        }
+    }
+    r->callCount = report->callCount - r->firstCall;
+    for(i = 0; i < reached; i++)
+    {
+        depthAt[work[i]] = STACK_UNREACHED;
+    }
+}
+// worstStack returns the most bytes routine and the routines it calls can push, including return addresses, computing it on first use
+// Calls back into a routine still being computed are recursion, flagged on every routine in the cycle and counted only once
+int worstStack(StackReport *report, int routine)
+{
+    Routine *r = &report->routines[routine];
+    CallSite *call;
+    int callee;
+    int depth;
+    int i;
+
+    if(r->worst >= 0)
+    {
+        return(r->worst);
+    }
+    if(r->visiting)
+    {
+        r->flags |= STACK_RECURSIVE;
+        return(-1);
+    }
+    r->visiting = 1;
+    r->worst = -1;
+    depth = r->local;
+    for(i = 0; i < r->callCount; i++)
+    {
+        call = &report->calls[r->firstCall + i];
+        callee = report->routineOf[call->callee];
+        if(callee < 0)
+        {
+            r->flags |= STACK_UNKNOWN; // Called outside the image
+            continue;
+        }
+        if(worstStack(report, callee) < 0)
+        {
+            r->flags |= STACK_RECURSIVE;
+            continue;
+        }
+        if(report->routines[callee].flags & STACK_RECURSIVE)
+        {
+            r->flags |= STACK_RECURSIVE;
+        }
+        if(call->depth + (call->tail ? 0 : 2) + report->routines[callee].worst > depth)
+        {
+            depth = call->depth + (call->tail ? 0 : 2) + report->routines[callee].worst;
+        }
+    }
+    r->visiting = 0;
+    r->worst = depth;
+    return(depth);
+}
+// printStack prints each routine's stack use and calls, then the stack use of each interrupt, which also pushes its return address
+void printStack(FILE *out, Flow *flow, StackReport *report)
+{
+    Routine *r;
+    int i;
+    int j;
+    int routine;
+
+    fprintf(out,"; Routine stack use in bytes, worst case including calls\n");
+    for(i = 0; i < report->routineCount; i++)
+    {
+        r = &report->routines[i];
+        fprintf(out,"; %04x worst %d own %d", r->address, r->worst, r->local);
+        if(r->shared)
+        {
+            fprintf(out," shared");
+        }
+        if(r->flags & STACK_RECURSIVE)
+        {
+            fprintf(out," recursive");
+        }
+        if(r->flags & STACK_UNKNOWN)
+        {
+            fprintf(out," unknown");
+        }
+        if(r->flags & STACK_UNBALANCED)
+        {
+            fprintf(out," unbalanced");
+        }
+        if(r->callCount > 0)
+        {
+            fprintf(out," calls");
+        }
+        for(j = 0; j < r->callCount; j++)
+        {
+            fprintf(out," %04x", report->calls[r->firstCall + j].callee);
+        }
+        fputc('\n', out);
+    }
+    if(flow->start != 0)
+    {
+        return;
+    }
+    for(i = 0; i < 8; i++)
+    {
+        routine = report->routineOf[i * 8];
+        if(routine >= 0)
+        {
+            fprintf(out,"; RST %d interrupt worst %d\n", i, report->routines[routine].worst + (i == 0 ? 0 : 2)); // Reset pushes nothing
+        }
+    }
+}
+
+// Code placed before the translation of an image: the processor state, the interface to the host and the operations shared by instructions
+static const char *translationPrelude[] = {
+    "#include <stdint.h>",
+    "",
+    "// Processor state, with the flags kept as carry, auxiliary carry and the last result, from which zero, sign and parity are derived when tested",
+    "// The host must load the image into memory before running it, since the translation reads its jump tables and data from there and holds no copy",
+    "struct i8080 {",
+    "    uint8_t a, b, c, d, e, h, l;",
+    "    uint8_t cy, ac, res;",
+    "    uint16_t sp, pc;",
+    "    int halted, inte;",
+    "    uint8_t memory[65536];",
+    "};",
+    "",
+    "// Supplied by the host: port input and output, and an interpreter executing at least one instruction from cpu->pc",
+    "// The interpreter runs code the translation could not reach, such as the targets of unresolved indirect jumps",
+    "uint8_t i8080_in(struct i8080 *cpu, uint8_t port);",
+    "void i8080_out(struct i8080 *cpu, uint8_t port, uint8_t value);",
+    "void i8080_interpret(struct i8080 *cpu);",
+    "",
+    "// Defined below: run from cpu->pc until HLT, or continue from cpu->pc into translated code or the interpreter",
+    "void i8080_run(struct i8080 *cpu);",
+    "void i8080_step(struct i8080 *cpu);",
+    "",
+    "#ifndef I8080_READ",
+    "#define I8080_READ(cpu, address) ((cpu)->memory[(uint16_t)(address)])",
+    "#endif",
+    "#ifndef I8080_WRITE",
+    "#define I8080_WRITE(cpu, address, value) ((cpu)->memory[(uint16_t)(address)] = (uint8_t)(value))",
+    "#endif",
+    "#define RD(address) I8080_READ(cpu, address)",
+    "#define WR(address, value) I8080_WRITE(cpu, address, value)",
+    "#define HL ((uint16_t)(h << 8 | l))",
+    "",
+    "// Registers live in locals within a routine and are written back whenever control leaves it",
+    "#define LOCALS uint8_t a = cpu->a, b = cpu->b, c = cpu->c, d = cpu->d, e = cpu->e, h = cpu->h, l = cpu->l, cy = cpu->cy, ac = cpu->ac, res = cpu->res; uint16_t sp = cpu->sp; unsigned t = 0, u = 0, w = 0; (void)t; (void)u; (void)w",
+    "#define SAVE() (cpu->a = a, cpu->b = b, cpu->c = c, cpu->d = d, cpu->e = e, cpu->h = h, cpu->l = l, cpu->cy = cy, cpu->ac = ac, cpu->res = res, cpu->sp = sp)",
+    "#define LOAD() (a = cpu->a, b = cpu->b, c = cpu->c, d = cpu->d, e = cpu->e, h = cpu->h, l = cpu->l, cy = cpu->cy, ac = cpu->ac, res = cpu->res, sp = cpu->sp)",
+    "#define EXIT(address) do { SAVE(); cpu->pc = (address); return; } while(0)",
+    "#define CALL(address, ret, function) do { PUSH(ret); SAVE(); cpu->pc = (address); function(cpu); while(cpu->pc != (ret) && !cpu->halted) i8080_step(cpu); if(cpu->halted) return; LOAD(); } while(0)",
+    "#define RET() do { POP(t); EXIT(t); } while(0)",
+    "#define PUSH(value) (t = (value), sp -= 2, WR(sp, t & 0xff), WR(sp + 1, t >> 8))",
+    "#define POP(into) (into = RD(sp) | RD(sp + 1) << 8, sp += 2)",
+    "",
+    "// Flags",
+    "#define PARITY(value) i8080_parity(value)",
+    "#define FLAGS() ((res & 0x80) | !res << 6 | ac << 4 | PARITY(res) << 2 | 2 | cy)",
+    "#define SETFLAGS(f) (cy = (f) & 1, ac = ((f) >> 4) & 1, res = i8080_result(f))",
+    "static inline int i8080_parity(uint8_t value)",
+    "{",
+    "    value ^= value >> 4;",
+    "    value ^= value >> 2;",
+    "    value ^= value >> 1;",
+    "    return !(value & 1);",
+    "}",
+    "// A last result giving the sign, zero and parity flags of flags, for POP PSW; impossible combinations are approximated",
+    "static inline uint8_t i8080_result(uint8_t flags)",
+    "{",
+    "    static const uint8_t results[8] = {0x01, 0x03, 0x00, 0x00, 0x80, 0x81, 0x80, 0x80}; // Indexed by S << 2 | Z << 1 | P",
+    "    return results[(flags >> 5 & 6) | (flags >> 2 & 1)];",
+    "}",
+    "",
+    "// Arithmetic and logic on A",
+    "#define ADD(value, carry) (u = (value), t = a + u + (carry), ac = ((a ^ u ^ t) >> 4) & 1, cy = t >> 8, a = res = (uint8_t)t)",
+    "#define SUB(value, borrow) (u = (uint8_t)~(value), t = a + u + !(borrow), ac = ((a ^ u ^ t) >> 4) & 1, cy = !(t >> 8), a = res = (uint8_t)t)",
+    "#define CMP(value) (u = (uint8_t)~(value), t = a + u + 1, ac = ((a ^ u ^ t) >> 4) & 1, cy = !(t >> 8), res = (uint8_t)t)",
+    "#define ANA(value) (u = (value), ac = ((a | u) >> 3) & 1, cy = 0, a = res = a & u)",
+    "#define XRA(value) (a = res = a ^ (value), cy = 0, ac = 0)",
+    "#define ORA(value) (a = res = a | (value), cy = 0, ac = 0)",
+    "#define DAA() do { u = 0; w = cy; if((a & 0x0f) > 9 || ac) u = 6; if(a > 0x99 || cy) { u |= 0x60; w = 1; } ADD(u, 0); cy = w; } while(0)",
+    "",
+    NULL
+};
+/*
+translate prints image as C, one function per routine of report, each called with the processor state and running until control leaves it
+As report gives code shared by routines a routine of its own, each instruction is translated once and other routines reach it through i8080_step
+Basic blocks become labels, resolved jump tables become switches, and anything not translated is left to the host's interpreter
+i8080_step calls the function of the routine at cpu->pc, or the interpreter for any other address
+*/
+void translate(FILE *out, Flow *flow, StackReport *report)
+{
+    uint8_t *member;
+    uint8_t *leader;
+    uint16_t *work;
+    int i;
+
+    member = (uint8_t *)calloc(8192, sizeof(uint8_t));
+    leader = (uint8_t *)calloc(8192, sizeof(uint8_t));
+    work = (uint16_t *)malloc(65536 * sizeof(uint16_t));
+    if(member == NULL || leader == NULL || work == NULL)
+    {
+        fprintf(stderr,"Out of memory!\n");
+        exit(99);
+    }
+    fprintf(out,"// Translated from an 8080 image loaded at %04x\n", flow->start);
+    for(i = 0; translationPrelude[i] != NULL; i++)
+    {
+        fprintf(out,"%s\n", translationPrelude[i]);
+    }
+    for(i = 0; i < report->routineCount; i++)
+    {
+        fprintf(out,"static void f_%04x(struct i8080 *cpu);\n", report->routines[i].address);
+    }
+    for(i = 0; i < report->routineCount; i++)
+    {
+        translateRoutine(out, flow, report, i, member, leader, work);
+    }
+    fprintf(out,"\nvoid i8080_step(struct i8080 *cpu)\n{\n    switch(cpu->pc)\n    {\n");
+    for(i = 0; i < report->routineCount; i++)
+    {
+        fprintf(out,"    case 0x%04x: f_%04x(cpu); break;\n", report->routines[i].address, report->routines[i].address);
+    }
+    fprintf(out,"    default: i8080_interpret(cpu);\n    }\n}\n");
+    fprintf(out,"\nvoid i8080_run(struct i8080 *cpu)\n{\n    while(!cpu->halted)\n    {\n        i8080_step(cpu);\n    }\n}\n");
+    free(member);
+    free(leader);
+    free(work);
+}
+// translateRoutine prints the function for routine, covering the code reached from its entry without entering other routines
+// member and leader must be all clear and are left that way, work is room for 65536 addresses
+void translateRoutine(FILE *out, Flow *flow, StackReport *report, int routine, uint8_t *member, uint8_t *leader, uint16_t *work)
+{
+    uint16_t entry = report->routines[routine].address;
+    uint16_t targets[TABLE_LIMIT + 1];
+    int reached = 0;
+    int pending = 0;
+    int location;
+    int callee;
+    int count;
+    int i;
+    int j;
+
+    BIT_SET(member, entry);
+    work[reached++] = entry;
+    while(pending < reached)
+    {
+        location = work[pending++];
+        count = flowSuccessors(flow, location, targets, &callee);
+        for(i = 0; i < count; i++)
+        {
+            // Stay within the image and leave other routines to their own functions
+            if(INSIDE(flow, targets[i]) && BIT_TEST(flow->code, targets[i]) && !BIT_TEST(member, targets[i]) && report->routineOf[targets[i]] < 0)
+            {
+                BIT_SET(member, targets[i]);
+                work[reached++] = targets[i];
+            }
+        }
+    }
+    qsort(work, reached, sizeof(uint16_t), compareAddress);
+    // Label every instruction reached other than by falling into it from the one translated before
+    for(i = 0; i < reached; i++)
+    {
+        location = work[i];
+        count = flowSuccessors(flow, location, targets, &callee);
+        for(j = 0; j < count; j++)
+        {
+            if(BIT_TEST(member, targets[j]) && (targets[j] != location + instLength(flow->memory[location]) || i + 1 == reached || work[i + 1] != targets[j]))
+            {
+                BIT_SET(leader, targets[j]);
+            }
+        }
+    }
+    fprintf(out,"\nstatic void f_%04x(struct i8080 *cpu)\n{\n    LOCALS;\n", entry);
+    // The code is printed in address order, so code below the entry is jumped over
+    if(work[0] != entry)
+    {
+        BIT_SET(leader, entry);
+        fprintf(out,"    goto L_%04x;\n", entry);
+    }
+    for(i = 0; i < reached; i++)
+    {
+        translateInstruction(out, flow, report, work[i], member, leader, i + 1 < reached ? work[i + 1] : -1);
+    }
+    fprintf(out,"}\n");
+    for(i = 0; i < reached; i++)
+    {
+        BIT_CLEAR(member, work[i]);
+        BIT_CLEAR(leader, work[i]);
+    }
+}
+// translateJump prints a transfer of control to target: a goto within the routine whose code is in member, otherwise leaving it
+void translateJump(FILE *out, uint8_t *member, int target)
+{
+    if(BIT_TEST(member, target))
+    {
+        fprintf(out,"goto L_%04x;", target);
+    }
+    else
+    {
+        fprintf(out,"EXIT(0x%04x);", target);
+    }
+}
+// translateTable prints a switch on value jumping to the resolved targets of the PCHL or RET at location, if there are any
+void translateTable(FILE *out, Flow *flow, int location, uint8_t *member, char *value)
+{
+    uint16_t targets[TABLE_LIMIT];
+    int table;
+    int count;
+    int i;
+    int j;
+
+    count = jumpTargets(flow, location, &flow->state[location], targets, &table);
+    if(count > 0)
+    {
+        fprintf(out,"switch(%s)\n    {\n", value);
+        for(i = 0; i < count; i++)
+        {
+            for(j = 0; j < i && targets[j] != targets[i]; j++);
+            if(j == i) // Tables may repeat a target, but a switch may not repeat a case
+            {
+                fprintf(out,"    case 0x%04x: ", targets[i]);
+                translateJump(out, member, targets[i]);
+                fputc('\n', out);
+            }
+        }
+        fprintf(out,"    }\n    ");
+    }
+}
+// translateCall prints a call to target returning to ret, directly into the function of a translated routine
+void translateCall(FILE *out, StackReport *report, int target, int ret)
+{
+    if(report->routineOf[target] >= 0)
+    {
+        fprintf(out,"CALL(0x%04x, 0x%04x, f_%04x);", target, ret, target);
+    }
+    else
+    {
+        fprintf(out,"CALL(0x%04x, 0x%04x, i8080_step);", target, ret);
+    }
+}
+/*
+translateInstruction prints the C for the instruction at location, preceded by its listing line as a comment
+It is labelled if it is set in leader; next is the location translated after it, or -1
+*/
+void translateInstruction(FILE *out, Flow *flow, StackReport *report, int location, uint8_t *member, uint8_t *leader, int next)
+{
+    static const char *regs[8] = {"b", "c", "d", "e", "h", "l", "RD(HL)", "a"};
+    static const char *pairs[4] = {"(b << 8 | c)", "(d << 8 | e)", "HL", "sp"};
+    static const char *conditions[8] = {"res", "!res", "!cy", "cy", "!PARITY(res)", "PARITY(res)", "!(res & 0x80)", "(res & 0x80)"};
+    static const char *alu[8] = {"ADD(%s, 0)", "ADD(%s, cy)", "SUB(%s, 0)", "SUB(%s, cy)", "ANA(%s)", "XRA(%s)", "ORA(%s)", "CMP(%s)"};
+    Listing list = {out, 0, NULL, NULL};
+    uint8_t *inst = flow->memory + location;
+    uint8_t opcode = *inst;
+    uint16_t address = inst[1] | inst[2] << 8;
+    uint16_t targets[TABLE_LIMIT];
+    int table;
+    int length = instLength(opcode);
+    int dest = (opcode >> 3) & 7;
+    int source = opcode & 7;
+    int pair = (opcode >> 4) & 3;
+    int fallsThrough = 1;
+    char operand[8];
+
+    if(BIT_TEST(leader, location))
+    {
+        fprintf(out,"L_%04x:\n", location);
+    }
+    list.origin = flow->start;
+    fprintf(out,"    // ");
+    readBuffer(&list, inst, location - flow->start, length, 1);
+    fprintf(out,"    ");
+    if(opcode >= 0x40 && opcode < 0x80 && opcode != 0x76) // MOV
+    {
+        if(dest == 6)
+        {
+            fprintf(out,"WR(HL, %s);", regs[source]);
+        }
+        else
+        {
+            fprintf(out,"%s = %s;", regs[dest], regs[source]);
+        }
+    }
+    else if(opcode >= 0x80 && opcode < 0xc0) // Arithmetic and logic on a register
+    {
+        fprintf(out, alu[dest], regs[source]);
+        fputc(';', out);
+    }
+    else if((opcode & 0xc7) == 0xc6) // Arithmetic and logic on an immediate value
+    {
+        snprintf(operand, sizeof(operand), "0x%02x", inst[1]);
+        fprintf(out, alu[dest], operand);
+        fputc(';', out);
+    }
+    else if((opcode & 0xc7) == 0x06) // MVI
+    {
+        if(dest == 6)
+        {
+            fprintf(out,"WR(HL, 0x%02x);", inst[1]);
+        }
+        else
+        {
+            fprintf(out,"%s = 0x%02x;", regs[dest], inst[1]);
+        }
+    }
+    else if((opcode & 0xc7) == 0x04 || (opcode & 0xc7) == 0x05) // INR and DCR
+    {
+        if(dest == 6)
+        {
+            fprintf(out,"u = (uint8_t)(RD(HL) %s 1); WR(HL, u); res = u;", opcode & 1 ? "-" : "+");
+        }
+        else
+        {
+            fprintf(out,"res = %s = (uint8_t)(%s %s 1);", regs[dest], regs[dest], opcode & 1 ? "-" : "+");
+        }
+        fprintf(out,opcode & 1 ? " ac = (res & 0x0f) != 0x0f;" : " ac = (res & 0x0f) == 0;");
+    }
+    else if((opcode & 0xcf) == 0x01) // LXI
+    {
+        if(pair == 3)
+        {
+            fprintf(out,"sp = 0x%04x;", address);
+        }
+        else
+        {
+            fprintf(out,"%s = 0x%02x; %s = 0x%02x;", regs[pair * 2], inst[2], regs[pair * 2 + 1], inst[1]);
+        }
+    }
+    else if((opcode & 0xc7) == 0x03) // INX and DCX
+    {
+        if(pair == 3)
+        {
+            fprintf(out,"sp %s= 1;", opcode & 8 ? "-" : "+");
+        }
+        else
+        {
+            fprintf(out,"t = (uint16_t)(%s %s 1); %s = t >> 8; %s = t & 0xff;", pairs[pair], opcode & 8 ? "-" : "+", regs[pair * 2], regs[pair * 2 + 1]);
+        }
+    }
+    else if((opcode & 0xcf) == 0x09) // DAD
+    {
+        fprintf(out,"t = HL + %s; h = (t >> 8) & 0xff; l = t & 0xff; cy = t >> 16;", pairs[pair]);
+    }
+    else if((opcode & 0xcf) == 0xc5) // PUSH
+    {
+        fprintf(out,"PUSH(%s);", pair == 3 ? "a << 8 | FLAGS()" : pairs[pair]);
+    }
+    else if((opcode & 0xcf) == 0xc1) // POP
+    {
+        if(pair == 3)
+        {
+            fprintf(out,"POP(w); a = w >> 8; SETFLAGS(w & 0xff);");
+        }
+        else
+        {
+            fprintf(out,"POP(w); %s = w >> 8; %s = w & 0xff;", regs[pair * 2], regs[pair * 2 + 1]);
+        }
+    }
+    else if(opcode == 0xc3 || (opcode & 0xc7) == 0xc2) // JMP and Jcc
+    {
+        if(opcode != 0xc3)
+        {
+            fprintf(out,"if(%s) ", conditions[dest]);
+        }
+        translateJump(out, member, address);
+        fallsThrough = opcode != 0xc3;
+    }
+    else if(opcode == 0xcd || (opcode & 0xc7) == 0xc4) // CALL and Ccc
+    {
+        if(opcode != 0xcd)
+        {
+            fprintf(out,"if(%s) ", conditions[dest]);
+        }
+        translateCall(out, report, address, (location + 3) & 0xffff);
+    }
+    else if((opcode & 0xc7) == 0xc7) // RST
+    {
+        translateCall(out, report, opcode & 0x38, (location + 1) & 0xffff);
+    }
+    else if(opcode == 0xc9 || (opcode & 0xc7) == 0xc0) // RET and Rcc
+    {
+        if(opcode != 0xc9)
+        {
+            fprintf(out,"if(%s) ", conditions[dest]);
+        }
+        if(jumpTargets(flow, location, &flow->state[location], targets, &table) > 0) // Returns into a resolved table of pushed addresses
+        {
+            fprintf(out,"{\n    POP(w);\n    ");
+            translateTable(out, flow, location, member, "w");
+            fprintf(out,"EXIT(w);\n    }");
+        }
+        else
+        {
+            fprintf(out,"RET();");
+        }
+        fallsThrough = opcode != 0xc9;
+    }
+    else if(opcode == 0xe9) // PCHL, through a switch when its targets were resolved
+    {
+        translateTable(out, flow, location, member, "HL");
+        fprintf(out,"EXIT(HL);");
+        fallsThrough = 0;
+    }
+    else
+    {
+        switch(opcode)
+        {
+        case 0x00: // NOP
+            fprintf(out,";");
+            break;
+        case 0x02: case 0x12: // STAX
+            fprintf(out,"WR(%s, a);", pairs[pair]);
+            break;
+        case 0x0a: case 0x1a: // LDAX
+            fprintf(out,"a = RD(%s);", pairs[pair]);
+            break;
+        case 0x07: // RLC
+            fprintf(out,"cy = a >> 7; a = (uint8_t)(a << 1 | cy);");
+            break;
+        case 0x0f: // RRC
+            fprintf(out,"cy = a & 1; a = (uint8_t)(a >> 1 | cy << 7);");
+            break;
+        case 0x17: // RAL
+            fprintf(out,"t = a >> 7; a = (uint8_t)(a << 1 | cy); cy = t;");
+            break;
+        case 0x1f: // RAR
+            fprintf(out,"t = a & 1; a = (uint8_t)(a >> 1 | cy << 7); cy = t;");
+            break;
+        case 0x22: // SHLD
+            fprintf(out,"WR(0x%04x, l); WR(0x%04x, h);", address, (address + 1) & 0xffff);
+            break;
+        case 0x2a: // LHLD
+            fprintf(out,"l = RD(0x%04x); h = RD(0x%04x);", address, (address + 1) & 0xffff);
+            break;
+        case 0x27: // DAA
+            fprintf(out,"DAA();");
+            break;
+        case 0x2f: // CMA
+            fprintf(out,"a = ~a;");
+            break;
+        case 0x32: // STA
+            fprintf(out,"WR(0x%04x, a);", address);
+            break;
+        case 0x3a: // LDA
+            fprintf(out,"a = RD(0x%04x);", address);
+            break;
+        case 0x37: // STC
+            fprintf(out,"cy = 1;");
+            break;
+        case 0x3f: // CMC
+            fprintf(out,"cy ^= 1;");
+            break;
+        case 0x76: // HLT
+            fprintf(out,"SAVE(); cpu->pc = 0x%04x; cpu->halted = 1; return;", (location + 1) & 0xffff);
+            fallsThrough = 0;
+            break;
+        case 0xd3: // OUT
+            fprintf(out,"SAVE(); i8080_out(cpu, 0x%02x, a);", inst[1]);
+            break;
+        case 0xdb: // IN
+            fprintf(out,"SAVE(); a = i8080_in(cpu, 0x%02x);", inst[1]);
+            break;
+        case 0xe3: // XTHL
+            fprintf(out,"t = l; l = RD(sp); WR(sp, t); t = h; h = RD(sp + 1); WR(sp + 1, t);");
+            break;
+        case 0xeb: // XCHG
+            fprintf(out,"t = d; d = h; h = t; t = e; e = l; l = t;");
+            break;
+        case 0xf3: // DI
+            fprintf(out,"cpu->inte = 0;");
+            break;
+        case 0xfb: // EI
+            fprintf(out,"cpu->inte = 1;");
+            break;
+        case 0xf9: // SPHL
+            fprintf(out,"sp = HL;");
+            break;
+        default: // Undocumented opcodes are left to the interpreter
+            fprintf(out,"EXIT(0x%04x);", location);
+            fallsThrough = 0;
+        }
+    }
+    fputc('\n', out);
+    if(fallsThrough && next != location + length) // Control falls into code not translated next
+    {
+        fprintf(out,"    ");
+        translateJump(out, member, (location + length) & 0xffff);
+        fputc('\n', out);
+    }
+}
+int compareAddress(const void *a, const void *b)
+{
+    return(*(const uint16_t *)a - *(const uint16_t *)b);
+}
+// noteAccess adds the memory or port reference made by inst, if it makes one, to access
+void noteAccess(AccessMap *access, uint8_t *inst)
+{
+    uint16_t address = inst[1] | inst[2] << 8;
+
+    switch(inst[0])
+    {
+    case 0x2a: // LHLD, then the low byte as LDA
+        BIT_SET(access->read, (uint16_t)(address + 1));
+        access->reads[(uint16_t)(address + 1)]++;
+        // fall through
+    case 0x3a: // LDA
+        BIT_SET(access->read, address);
+        access->reads[address]++;
+        break;
+    case 0x22: // SHLD, then the low byte as STA
+        BIT_SET(access->written, (uint16_t)(address + 1));
+        access->writes[(uint16_t)(address + 1)]++;
+        // fall through
+    case 0x32: // STA
+        BIT_SET(access->written, address);
+        access->writes[address]++;
+        break;
+    case 0xdb: // IN
+        BIT_SET(access->input, inst[1]);
+        access->ins[inst[1]]++;
+        break;
+    case 0xd3: // OUT
+        BIT_SET(access->output, inst[1]);
+        access->outs[inst[1]]++;
+        break;
+    }
+}
+/*
+printAccess prints the memory map and port table of access after a listing
+Consecutive addresses referenced the same way, read (R), written (W) or both (RW), are coalesced into one region with the total references to it
+*/
+void printAccess(FILE *out, AccessMap *access)
+{
+    static const char *kinds[4] = {"", "R", "W", "RW"};
+    uint64_t reads;
+    uint64_t writes;
+    int address = 0;
+    int start;
+    int kind;
+    int port;
+
+    fprintf(out,"; Memory\n");
+    while(address < 65536)
+    {
+        if(access->read[address / 8] == 0 && access->written[address / 8] == 0)
+        {
+            address = (address | 7) + 1; // Skip the rest of a byte of both bitmaps with nothing referenced
+            continue;
+        }
+        kind = (BIT_TEST(access->read, address) != 0) | (BIT_TEST(access->written, address) != 0) << 1;
+        if(kind == 0)
+        {
+            address++;
+            continue;
+        }
+        start = address;
+        reads = 0;
+        writes = 0;
+        while(address < 65536 && ((BIT_TEST(access->read, address) != 0) | (BIT_TEST(access->written, address) != 0) << 1) == kind)
+        {
+            reads += access->reads[address];
+            writes += access->writes[address];
+            address++;
+        }
+        fprintf(out,"; %04x-%04x %-2s reads %" PRIu64 " writes %" PRIu64 "\n", start, address - 1, kinds[kind], reads, writes);
+    }
+    fprintf(out,"; Ports\n");
+    for(port = 0; port < 256; port++)
+    {
+        if(BIT_TEST(access->input, port) || BIT_TEST(access->output, port))
+        {
+            fprintf(out,"; %02x in %" PRIu32 " out %" PRIu32 "\n", port, access->ins[port], access->outs[port]);
         }
     }
 }